@@ -0,0 +1,163 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include "Instruction.h"
+#include "Options.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+const char * const WORKLOAD_CLASS_NAMES[WORK_CLASSES]{ "add", "sub", "lb", "sb", "nop" };
+const uint32_t BENCHMARK_ROUNDS{ 0x3 }; // timed runs of an unobserved variant, the fastest counts
+
+//*******************************************************************
+// Synthetic trace - reproducible instruction stream for a workload *
+// mix, same interface as TraceReader; loads and stores address off *
+// $0 so every access stays inside the initialized first KiB       *
+//*******************************************************************
+class SyntheticTrace
+{
+private:
+	WorkloadMix mix;
+	uint64_t state, consumed;
+	uint32_t totalWeight;
+	uint8_t recent[MAX_DEPENDENCY_DISTANCE]; // destination registers of the last instructions, 0 when none
+
+	uint32_t Random(uint32_t);
+	uint32_t Register() { return 0x1 + Random(0x1F); }
+	uint32_t Source();
+public:
+	explicit SyntheticTrace(const WorkloadMix &);
+	bool Next(uint32_t &);
+	bool Seek(uint64_t target) const { return target == consumed; } // straight-line code only, never branches back
+};
+
+SyntheticTrace::SyntheticTrace(const WorkloadMix & workload) : mix(workload), consumed(0x0)
+{
+	state = mix.seed == 0x0 ? 0x1 : mix.seed;
+	totalWeight = 0x0;
+
+	for (uint32_t weight : mix.weights) { totalWeight += weight; }
+	for (uint8_t & reg : recent) { reg = 0x0; }
+	if (mix.dependencyDistance > MAX_DEPENDENCY_DISTANCE) { mix.dependencyDistance = MAX_DEPENDENCY_DISTANCE; }
+}
+
+// xorshift64* - cheap, and identical across platforms for a given seed
+uint32_t SyntheticTrace::Random(uint32_t range)
+{
+	state ^= state >> 12;
+	state ^= state << 25;
+	state ^= state >> 27;
+
+	return static_cast<uint32_t>(((state * 0x2545F4914F6CDD1DULL) >> 32) % range);
+}
+
+// a source register - the destination from dependencyDistance back when it has one
+uint32_t SyntheticTrace::Source()
+{
+	if (mix.dependencyDistance != 0x0)
+	{
+		uint32_t reg{ recent[(consumed + MAX_DEPENDENCY_DISTANCE - mix.dependencyDistance) % MAX_DEPENDENCY_DISTANCE] };
+		if (reg != 0x0) { return reg; }
+	}
+
+	return Register();
+}
+
+//*******************************************************
+// Next - generate the next instruction of the mix,     *
+// returns false once the instruction count is reached  *
+//*******************************************************
+bool SyntheticTrace::Next(uint32_t & instruction)
+{
+	if (consumed == mix.instructions) { return false; }
+
+	uint32_t pick{ Random(totalWeight) }, cls{ 0x0 }, dest{ 0x0 }, source1{ 0x0 }, source2{ 0x0 };
+	while (pick >= mix.weights[cls]) { pick -= mix.weights[cls++]; }
+
+	switch (cls)
+	{
+	case WORK_ADD:
+	case WORK_SUB:
+		// drawn one at a time so the stream does not depend on evaluation order
+		dest = Register();
+		source1 = Source();
+		source2 = Source();
+		instruction = (source1 << READ_REG1_SHIFT) | (source2 << READ_REG2_SHIFT) | (dest << WRITE_REG_15_11_SHIFT) |
+			(cls == WORK_ADD ? 0x20 : 0x22);
+		break;
+	case WORK_LB:
+		dest = Register();
+		instruction = (0x20 << OPCODE_SHIFT) | (dest << WRITE_REG_20_16_SHIFT) | Random(0x400);
+		break;
+	case WORK_SB:
+		instruction = (0x28 << OPCODE_SHIFT) | (Source() << READ_REG2_SHIFT) | Random(0x400);
+		break;
+	default:
+		instruction = 0x0;
+		break;
+	}
+
+	recent[consumed % MAX_DEPENDENCY_DISTANCE] = static_cast<uint8_t>(dest);
+	++consumed;
+
+	return true;
+}
+
+//************************************************************
+// PeakResidentBytes - the process's peak resident set size *
+//************************************************************
+uint64_t PeakResidentBytes()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters{};
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) { return 0x0; }
+	return counters.PeakWorkingSetSize;
+#else
+	struct rusage usage {};
+	if (getrusage(RUSAGE_SELF, &usage) != 0) { return 0x0; }
+#ifdef __APPLE__
+	return static_cast<uint64_t>(usage.ru_maxrss); // bytes on macOS
+#else
+	return static_cast<uint64_t>(usage.ru_maxrss) * 0x400; // KiB elsewhere
+#endif
+#endif
+}
+
+//*****************************************************************
+// ReportBenchmark - print the workload and the measured rates    *
+// of the fastest of the rounds run                               *
+//*****************************************************************
+void ReportBenchmark(std::ostream & out, const WorkloadMix & mix, uint32_t rounds, uint64_t cycles, double seconds)
+{
+	out << "workload: " << mix.instructions << " instructions, seed " << mix.seed << ", dependency distance " << mix.dependencyDistance << ", mix";
+	for (size_t i{ 0x0 }; i < WORK_CLASSES; ++i) { out << ' ' << WORKLOAD_CLASS_NAMES[i] << '=' << mix.weights[i]; }
+	out << std::endl;
+
+	out << "rounds: " << rounds << ", fastest shown" << std::endl;
+	out << "cycles: " << cycles << std::endl;
+	out << "seconds: " << seconds << std::endl;
+	out << "cycles/second: " << (seconds > 0.0 ? cycles / seconds : 0.0) << std::endl;
+	out << "ns/cycle: " << (cycles > 0x0 ? seconds * 1e9 / cycles : 0.0) << std::endl;
+	out << "peak RSS: " << PeakResidentBytes() / 0x400 << " KiB" << std::endl;
+}
+
+//****************************************************************
+// ReportStrippedLoop - print the stripped loop's rate and how   *
+// the variant's time compares with it, 1 being parity           *
+//****************************************************************
+void ReportStrippedLoop(std::ostream & out, uint64_t cycles, double seconds, double variantSeconds)
+{
+	out << "stripped loop cycles: " << cycles << std::endl;
+	out << "stripped loop ns/cycle: " << (cycles > 0x0 ? seconds * 1e9 / cycles : 0.0) << std::endl;
+	out << "variant/stripped loop: " << (seconds > 0.0 ? variantSeconds / seconds : 0.0) << std::endl;
+}
+
+#endif
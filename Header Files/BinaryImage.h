@@ -0,0 +1,127 @@
+#ifndef BINARYIMAGE_H
+#define BINARYIMAGE_H
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include "ImageFormat.h"
+#include "MappedFile.h"
+#include "SparseMemory.h"
+
+//*******************************************************************
+// Binary instruction image - memory maps an image file and exposes *
+// its text and data sections in place, without copying the words   *
+//*******************************************************************
+class BinaryImage
+{
+private:
+	MappedFile file;
+	const ImageHeader * header;
+	const uint32_t * text; // instruction words, still little-endian
+	const uint32_t * data; // data section words, still little-endian
+public:
+	BinaryImage() : header(nullptr), text(nullptr), data(nullptr) {}
+	bool Open(const std::string &);
+	bool SeedMemory(SparseMemory &) const;
+
+	uint32_t GetTextWords() const { return ImageWord(header->textWords); }
+	const uint32_t * GetText() const { return text; }
+
+	static bool IsImage(const char *, size_t);
+};
+
+//***************************************************************
+// IsImage - true if the leading bytes carry the image magic    *
+//***************************************************************
+bool BinaryImage::IsImage(const char * bytes, size_t count)
+{
+	return count >= sizeof(IMAGE_MAGIC) && memcmp(bytes, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) == 0;
+}
+
+//**************************************************************
+// Open - map the image and validate the header against the    *
+// file size, returns false (with a message) if it is invalid  *
+//**************************************************************
+bool BinaryImage::Open(const std::string & filename)
+{
+	if (!file.Open(filename))
+	{
+		std::cerr << "Error: unable to map input image: " << filename << std::endl;
+		return false;
+	}
+
+	header = reinterpret_cast<const ImageHeader *>(file.GetData());
+	if (file.GetSize() < sizeof(ImageHeader) || !IsImage(header->magic, sizeof(header->magic)) ||
+		ImageWord(header->version) != IMAGE_VERSION)
+	{
+		std::cerr << "Error: not a version " << IMAGE_VERSION << " instruction image: " << filename << std::endl;
+		return false;
+	}
+
+	uint64_t words{ static_cast<uint64_t>(ImageWord(header->textWords)) + ImageWord(header->dataWords) };
+	if (sizeof(ImageHeader) + words * sizeof(uint32_t) > file.GetSize())
+	{
+		std::cerr << "Error: truncated instruction image: " << filename << std::endl;
+		return false;
+	}
+
+	text = reinterpret_cast<const uint32_t *>(file.GetData() + sizeof(ImageHeader));
+	data = text + ImageWord(header->textWords);
+
+	return true;
+}
+
+//****************************************************************
+// SeedMemory - copy the data section over main memory, each     *
+// data word as 4 bytes in main memory's byte order, as lw and   *
+// sw see main memory                                            *
+//****************************************************************
+bool BinaryImage::SeedMemory(SparseMemory & mainMemory) const
+{
+	uint64_t base{ ImageWord(header->dataBase) }, words{ ImageWord(header->dataWords) };
+
+	if (base + words * sizeof(uint32_t) > 0x100000000ULL)
+	{
+		std::cerr << "Error: image data section does not fit in main memory" << std::endl;
+		return false;
+	}
+
+	for (uint64_t i{ 0x0 }; i < words; ++i)
+	{
+		mainMemory.Store(static_cast<uint32_t>(base + i * sizeof(uint32_t)), ImageWord(data[i]), sizeof(uint32_t));
+	}
+
+	return true;
+}
+
+//*****************************************************************
+// Image trace reader - hands the mapped text section to the      *
+// fetch stage one word at a time, same interface as TraceReader; *
+// the text section is the instruction memory, word i at 4 * i    *
+//*****************************************************************
+class ImageTraceReader
+{
+private:
+	const uint32_t * text;
+	uint64_t count, position;
+public:
+	explicit ImageTraceReader(const BinaryImage & image) : text(image.GetText()), count(image.GetTextWords()), position(0x0) {}
+
+	bool Next(uint32_t & instruction)
+	{
+		if (position >= count) { return false; }
+		instruction = ImageWord(text[position++]);
+		return true;
+	}
+
+	bool Seek(uint64_t target)
+	{
+		if (target > count) { return false; }
+		position = target;
+		return true;
+	}
+
+};
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef BRANCHPREDICTOR_H
+#define BRANCHPREDICTOR_H
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+#include "Checkpoint.h"
+#include "Options.h"
+
+//*****************************************************************
+// BTB entry - the target of a taken branch or jump, tagged with  *
+// the full address of the instruction; instruction memory never  *
+// changes, so a hit always has the right target                  *
+//*****************************************************************
+struct BtbEntry
+{
+	uint32_t pc, target;
+	bool valid, conditional; // jumps are always taken, branches ask the direction counters
+};
+
+//*******************************************************************
+// Branch predictor - consulted by fetch with nothing but the pc:  *
+// it predicts taken only when the BTB knows the target and, for   *
+// a conditional branch, the 2 bit counter says taken; bimodal     *
+// indexes the counters by pc, gshare by pc xor the global history *
+// of branch outcomes, which is updated as branches resolve rather *
+// than speculatively at fetch                                     *
+//*******************************************************************
+class BranchPredictor
+{
+private:
+	PredictorConfig config;
+	std::vector<uint8_t> counters; // 0-1 predict not taken, 2-3 taken
+	std::vector<BtbEntry> btb;
+	uint32_t history;
+
+	static bool IsPowerOfTwo(uint32_t val) { return val != 0x0 && (val & (val - 0x1)) == 0x0; }
+	uint8_t & Counter(uint32_t);
+	BtbEntry & Entry(uint32_t pc) { return btb[(pc >> 2) & (config.btbEntries - 0x1)]; }
+public:
+	BranchPredictor() : history(0x0) {}
+	bool Configure(const PredictorConfig &);
+	bool Predict(uint32_t, uint32_t &);
+	void Update(uint32_t, bool, uint32_t, bool);
+
+	void Save(std::ostream &) const;
+	bool Load(std::istream &);
+};
+
+//******************************************************************
+// Configure - size the tables, returns false if a size is not a  *
+// power of two; the static predictor needs no tables at all      *
+//******************************************************************
+bool BranchPredictor::Configure(const PredictorConfig & predictorConfig)
+{
+	config = predictorConfig;
+	counters.clear();
+	btb.clear();
+	history = 0x0;
+
+	if (config.kind == PredictorKind::NotTaken) { return true; }
+	if (!IsPowerOfTwo(config.counters) || !IsPowerOfTwo(config.btbEntries)) { return false; }
+
+	counters.assign(config.counters, 0x1); // weakly not taken
+	btb.assign(config.btbEntries, BtbEntry{ 0x0, 0x0, false, false });
+
+	return true;
+}
+
+// the direction counter for a branch address
+uint8_t & BranchPredictor::Counter(uint32_t pc)
+{
+	uint32_t index{ pc >> 2 };
+
+	if (config.kind == PredictorKind::Gshare) { index ^= history; }
+
+	return counters[index & (config.counters - 0x1)];
+}
+
+//****************************************************************
+// Predict - true, with the target, if the instruction at pc is  *
+// predicted to be a taken branch or jump                        *
+//****************************************************************
+bool BranchPredictor::Predict(uint32_t pc, uint32_t & target)
+{
+	if (btb.empty()) { return false; }
+
+	const BtbEntry & entry{ Entry(pc) };
+	if (!entry.valid || entry.pc != pc) { return false; }
+	if (entry.conditional && Counter(pc) < 0x2) { return false; }
+
+	target = entry.target;
+
+	return true;
+}
+
+//***************************************************************
+// Update - train on a resolved branch (conditional) or jump:  *
+// taken ones go into the BTB, and branches move their counter *
+// and shift their outcome into the global history             *
+//***************************************************************
+void BranchPredictor::Update(uint32_t pc, bool taken, uint32_t target, bool conditional)
+{
+	if (btb.empty()) { return; }
+
+	if (conditional)
+	{
+		uint8_t & counter{ Counter(pc) };
+
+		if (taken && counter < 0x3) { ++counter; }
+		else if (!taken && counter > 0x0) { --counter; }
+
+		history = ((history << 1) | (taken ? 0x1 : 0x0)) & (config.counters - 0x1);
+	}
+
+	if (taken) { Entry(pc) = BtbEntry{ pc, target, true, conditional }; }
+}
+
+//**************************************************************
+// Save - write the configuration and tables, so a restore of *
+// the same predictor continues warm                          *
+//**************************************************************
+void BranchPredictor::Save(std::ostream & out) const
+{
+	WriteRaw(out, config);
+	WriteRaw(out, history);
+
+	for (uint8_t counter : counters) { WriteRaw(out, counter); }
+	for (const BtbEntry & entry : btb) { WriteRaw(out, entry); }
+}
+
+//*****************************************************************
+// Load - read tables written by Save; when the saved predictor  *
+// differs from the configured one it is skipped and stays cold   *
+//*****************************************************************
+bool BranchPredictor::Load(std::istream & in)
+{
+	PredictorConfig saved;
+	uint32_t savedHistory{ 0x0 };
+
+	if (!ReadRaw(in, saved) || !ReadRaw(in, savedHistory)) { return false; }
+
+	bool same{ saved.kind == config.kind && saved.counters == config.counters && saved.btbEntries == config.btbEntries };
+	bool tables{ saved.kind != PredictorKind::NotTaken };
+
+	if (same) { history = savedHistory; }
+
+	for (uint32_t i{ 0x0 }; tables && i < saved.counters; ++i)
+	{
+		uint8_t counter{ 0x0 };
+		if (!ReadRaw(in, counter)) { return false; }
+		if (same) { counters[i] = counter; }
+	}
+
+	for (uint32_t i{ 0x0 }; tables && i < saved.btbEntries; ++i)
+	{
+		BtbEntry entry;
+		if (!ReadRaw(in, entry)) { return false; }
+		if (same) { btb[i] = entry; }
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <type_traits>
+
+//**********************************************************************
+// Checkpoint file - a header, then the processor state, then every   *
+// allocated memory page; values are raw host-order bytes, so a       *
+// checkpoint is only meant to be restored by the build that made it  *
+//**********************************************************************
+struct CheckpointHeader
+{
+	char magic[4]; // CHECKPOINT_MAGIC
+	uint32_t version; // CHECKPOINT_VERSION
+	uint64_t cycle; // cycles simulated when the checkpoint was taken
+	uint64_t tracePosition; // trace word the next fetch reads - pc / 4
+};
+
+const char CHECKPOINT_MAGIC[4]{ 'M', 'P', 'S', 'C' };
+const uint32_t CHECKPOINT_VERSION{ 0x5 };
+
+static_assert(sizeof(CheckpointHeader) == 24, "checkpoint header layout must not change");
+
+// raw copies of trivially copyable state in and out of a checkpoint
+template <class T>
+void WriteRaw(std::ostream & out, const T & val)
+{
+	static_assert(std::is_trivially_copyable<T>::value, "only plain state can be written raw");
+	out.write(reinterpret_cast<const char *>(&val), sizeof(val));
+}
+
+template <class T>
+bool ReadRaw(std::istream & in, T & val)
+{
+	static_assert(std::is_trivially_copyable<T>::value, "only plain state can be read raw");
+	return static_cast<bool>(in.read(reinterpret_cast<char *>(&val), sizeof(val)));
+}
+
+#endif
@@ -0,0 +1,440 @@
+#ifndef COSIMULATION_H
+#define COSIMULATION_H
+
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include "Control.h"
+#include "Instruction.h"
+#include "Processor.h"
+#include "SparseMemory.h"
+
+// what retiring an instruction changed, if anything; the reference model reports encodings it does not implement
+enum class EffectKind : uint8_t { None, Register, Store, Unsupported };
+
+//*****************************************************************
+// Retired effect - the architectural change one instruction made *
+// as it retired: a register write, or a store of size bytes      *
+//*****************************************************************
+struct RetiredEffect
+{
+	EffectKind kind;
+	uint32_t target; // register number or byte address
+	uint32_t value; // stores keep only their low size bytes
+	uint32_t size;
+
+	bool operator==(const RetiredEffect & other) const
+	{
+		return kind == other.kind && target == other.target && value == other.value && size == other.size;
+	}
+};
+
+//********************************************************************
+// Reference model - a plain interpreter of the supported MIPS       *
+// subset, one instruction at a time on its own registers and main   *
+// memory; it decodes the instruction bits itself, sharing nothing   *
+// with the pipeline's control ROM, predecode cache or latches, so   *
+// the two only agree when the pipeline gets the architecture right  *
+//********************************************************************
+class ReferenceModel
+{
+private:
+	int32_t regs[0x20];
+	uint32_t pc;
+	SparseMemory memory;
+
+	RetiredEffect Write(uint32_t, uint32_t);
+	RetiredEffect Load(uint32_t, uint32_t, uint32_t, bool);
+	RetiredEffect Store(uint32_t, uint32_t, uint32_t);
+public:
+	ReferenceModel() : regs{}, pc(0x0) {}
+
+	template <class Config>
+	void Start(const Processor<Config> &, const SparseMemory &);
+	RetiredEffect Execute(uint32_t);
+
+	uint32_t GetPc() const { return pc; }
+	int32_t GetRegister(uint32_t reg) const { return regs[reg]; }
+};
+
+//****************************************************************
+// Start - take over the processor's registers and pc and a copy *
+// of main memory; the pipeline must be empty, as it is before   *
+// the first cycle, so nothing is still in flight                *
+//****************************************************************
+template <class Config>
+void ReferenceModel::Start(const Processor<Config> & processor, const SparseMemory & mainMemory)
+{
+	std::stringstream pages;
+
+	for (uint32_t reg{ 0x0 }; reg < 0x20; ++reg) { regs[reg] = processor.GetRegister(reg); }
+	pc = processor.GetPc();
+
+	mainMemory.Save(pages); // the checkpoint format doubles as a deep copy
+	memory.Load(pages);
+}
+
+// Write - a register write, $0 stays zero and so changes nothing
+RetiredEffect ReferenceModel::Write(uint32_t reg, uint32_t val)
+{
+	if (reg == 0x0) { return RetiredEffect{ EffectKind::None, 0x0, 0x0, 0x0 }; }
+
+	regs[reg] = static_cast<int32_t>(val);
+	return RetiredEffect{ EffectKind::Register, reg, val, 0x4 };
+}
+
+// Load - read size bytes in memory byte order into reg, sign extended below a word
+RetiredEffect ReferenceModel::Load(uint32_t reg, uint32_t address, uint32_t size, bool signExtend)
+{
+	uint32_t val{ memory.Load(address, size) };
+
+	if (signExtend && size == 0x1) { val = static_cast<uint32_t>(static_cast<int32_t>(static_cast<int8_t>(val))); }
+	if (signExtend && size == 0x2) { val = static_cast<uint32_t>(static_cast<int32_t>(static_cast<int16_t>(val))); }
+
+	return Write(reg, val);
+}
+
+// Store - write the low size bytes of val in memory byte order
+RetiredEffect ReferenceModel::Store(uint32_t address, uint32_t val, uint32_t size)
+{
+	uint32_t mask{ size == 0x4 ? 0xFFFFFFFF : (0x1u << (8 * size)) - 0x1 };
+
+	memory.Store(address, val, size);
+	return RetiredEffect{ EffectKind::Store, address, val & mask, size };
+}
+
+//**************************************************************
+// Execute - run the instruction at pc and move pc on: no delay *
+// slots, jr drops the low two target bits, and an opcode or    *
+// function it does not implement is reported as unsupported    *
+// rather than run, so a check never passes over one            *
+//**************************************************************
+RetiredEffect ReferenceModel::Execute(uint32_t instruction)
+{
+	uint32_t opcode{ (instruction & OPCODE_BM) >> OPCODE_SHIFT };
+	uint32_t rs{ (instruction & READ_REG1_BM) >> READ_REG1_SHIFT }, rt{ (instruction & READ_REG2_BM) >> READ_REG2_SHIFT };
+	uint32_t rd{ (instruction & WRITE_REG_15_11_BM) >> WRITE_REG_15_11_SHIFT }, shamt{ (instruction & SHAMT_BM) >> SHAMT_SHIFT };
+	uint32_t immediate{ instruction & OFFSET_BM };
+	uint32_t signedImmediate{ static_cast<uint32_t>(static_cast<int32_t>(static_cast<int16_t>(immediate))) };
+	uint32_t s{ static_cast<uint32_t>(regs[rs]) }, t{ static_cast<uint32_t>(regs[rt]) };
+	uint32_t nextPc{ pc + 0x4 };
+	RetiredEffect nothing{ EffectKind::None, 0x0, 0x0, 0x0 };
+	RetiredEffect unsupported{ EffectKind::Unsupported, 0x0, instruction, 0x0 };
+
+	pc = nextPc;
+
+	switch (opcode)
+	{
+	case 0x00: // r-format
+		switch (instruction & FUNCTION_BM)
+		{
+		case 0x00: return Write(rd, t << shamt); // sll
+		case 0x02: return Write(rd, t >> shamt); // srl
+		case JR_FUNCTION: pc = s & ~0x3; return nothing;
+		case 0x20: case 0x21: return Write(rd, s + t); // add, addu
+		case 0x22: case 0x23: return Write(rd, s - t); // sub, subu
+		case 0x24: return Write(rd, s & t); // and
+		case 0x25: return Write(rd, s | t); // or
+		case 0x2A: return Write(rd, regs[rs] < regs[rt] ? 0x1 : 0x0); // slt
+		default: return unsupported;
+		}
+	case 0x02: // j
+		pc = (nextPc & 0xF0000000) | ((instruction & JUMP_INDEX_BM) << 2);
+		return nothing;
+	case 0x03: // jal
+		pc = (nextPc & 0xF0000000) | ((instruction & JUMP_INDEX_BM) << 2);
+		return Write(LINK_REG, nextPc);
+	case 0x04: // beq
+		if (s == t) { pc = nextPc + (signedImmediate << 2); }
+		return nothing;
+	case 0x05: // bne
+		if (s != t) { pc = nextPc + (signedImmediate << 2); }
+		return nothing;
+	case 0x08: case 0x09: return Write(rt, s + signedImmediate); // addi, addiu
+	case 0x0A: return Write(rt, regs[rs] < static_cast<int32_t>(signedImmediate) ? 0x1 : 0x0); // slti
+	case 0x0C: return Write(rt, s & immediate); // andi
+	case 0x0D: return Write(rt, s | immediate); // ori
+	case 0x0F: return Write(rt, immediate << 16); // lui
+	case 0x20: return Load(rt, s + signedImmediate, 0x1, true); // lb
+	case 0x21: return Load(rt, s + signedImmediate, 0x2, true); // lh
+	case 0x23: return Load(rt, s + signedImmediate, 0x4, false); // lw
+	case 0x28: return Store(s + signedImmediate, t, 0x1); // sb
+	case 0x29: return Store(s + signedImmediate, t, 0x2); // sh
+	case 0x2B: return Store(s + signedImmediate, t, 0x4); // sw
+	default: return unsupported;
+	}
+}
+
+const uint32_t COSIM_HISTORY{ 0x8 }; // retired instructions shown before a divergence
+
+//********************************************************************
+// Co-simulation - runs the reference model in lockstep with the     *
+// pipeline: each cycle, every instruction leaving write back is     *
+// run on the reference too, and the register write or store it      *
+// made is compared with the reference's; the first that differs     *
+// stops the run, and the register files are compared once more      *
+// when it ends                                                      *
+// - the reference reads its instructions through a trace reader of  *
+//   its own, so fetch going wrong shows up as well                  *
+// - stores are read back from main memory at the end of the cycle   *
+//   the memory stage made them, a cycle before they leave write     *
+//   back, so what memory really got is compared; one a younger      *
+//   slot of the same bundle overwrote is taken off its latch        *
+// - checking costs a few compares per cycle and one interpreted     *
+//   instruction per retired one, cheap enough to leave on           *
+//********************************************************************
+template <class Trace>
+class CoSimulation
+{
+private:
+	Trace & trace;
+	uint64_t position; // word address the trace reads next
+	ReferenceModel reference;
+	RetiredEffect stores[MAX_ISSUE_WIDTH]; // what the memory stage stored last cycle, slot by slot
+	uint32_t historyPc[COSIM_HISTORY], historyInstruction[COSIM_HISTORY];
+	uint64_t checked;
+	std::string divergence; // empty while the two agree
+
+	uint32_t Fetch(uint32_t);
+	template <class Config>
+	static RetiredEffect Stored(const Processor<Config> &, uint32_t, const SparseMemory &);
+	static RetiredEffect Retired(const MEMWB &, const RetiredEffect &);
+	static void Describe(std::ostream &, const RetiredEffect &);
+	void DescribeHistory(std::ostream &) const;
+	void Diverge(uint64_t, uint32_t, uint32_t, const RetiredEffect &, const RetiredEffect &);
+public:
+	explicit CoSimulation(Trace & reader) : trace(reader), position(UINT64_MAX), checked(0x0) {}
+
+	template <class Config>
+	void Start(const Processor<Config> &, const SparseMemory &);
+	template <class Config>
+	void Check(const Processor<Config> &, const SparseMemory &, uint64_t);
+	template <class Config>
+	bool Finish(const Processor<Config> &, bool);
+
+	bool HasDiverged() const { return !divergence.empty(); }
+	const std::string & GetDivergence() const { return divergence; }
+	uint64_t GetChecked() const { return checked; }
+};
+
+//*****************************************************************
+// Unchecked - stands in for the co-simulation in the variants    *
+// not compiled to watch the run, which are never checked, so     *
+// none of the checker's code is instantiated for them            *
+//*****************************************************************
+template <class Trace>
+class Unchecked
+{
+public:
+	explicit Unchecked(Trace &) {}
+
+	template <class Config>
+	void Start(const Processor<Config> &, const SparseMemory &) {}
+	template <class Config>
+	void Check(const Processor<Config> &, const SparseMemory &, uint64_t) {}
+	template <class Config>
+	bool Finish(const Processor<Config> &, bool) { return true; }
+
+	bool HasDiverged() const { return false; }
+	std::string GetDivergence() const { return std::string(); }
+	uint64_t GetChecked() const { return 0x0; }
+};
+
+// Checker - what a variant checks its runs with, a real co-simulation only where the run is observed
+template <class Config, class Trace>
+using Checker = typename std::conditional<Config::OBSERVED, CoSimulation<Trace>, Unchecked<Trace>>::type;
+
+// Start - line the reference up with the processor before the first cycle
+template <class Trace>
+template <class Config>
+void CoSimulation<Trace>::Start(const Processor<Config> & processor, const SparseMemory & mainMemory)
+{
+	reference.Start(processor, mainMemory);
+	for (RetiredEffect & store : stores) { store = RetiredEffect{ EffectKind::None, 0x0, 0x0, 0x0 }; }
+}
+
+// Fetch - the instruction at pc, a no-op past the end of the trace, where the pipeline fetches nothing
+template <class Trace>
+uint32_t CoSimulation<Trace>::Fetch(uint32_t pc)
+{
+	uint64_t target{ pc >> 2 };
+	uint32_t instruction{ 0x0 };
+
+	if ((position == target || trace.Seek(target)) && trace.Next(instruction))
+	{
+		position = target + 0x1;
+		return instruction;
+	}
+
+	position = UINT64_MAX;
+	return 0x0;
+}
+
+//*****************************************************************
+// Stored - the store the memory stage made from slot this cycle, *
+// as main memory now holds it, or off the latch when a younger   *
+// slot of the bundle stored over some of the same bytes          *
+//*****************************************************************
+template <class Trace>
+template <class Config>
+RetiredEffect CoSimulation<Trace>::Stored(const Processor<Config> & processor, uint32_t slot, const SparseMemory & mainMemory)
+{
+	const EXMEM & mem{ processor.GetMemoryInput(slot) };
+
+	if (!mem.GetMemWrite()) { return RetiredEffect{ EffectKind::None, 0x0, 0x0, 0x0 }; }
+
+	uint32_t address{ static_cast<uint32_t>(mem.GetAluResult()) }, size{ MemAccessSize(mem.GetControl()) };
+	uint32_t mask{ size == 0x4 ? 0xFFFFFFFF : (0x1u << (8 * size)) - 0x1 };
+	bool overwritten{ false };
+
+	for (uint32_t younger{ slot + 0x1 }; younger < processor.GetIssueWidth(); ++younger)
+	{
+		const EXMEM & later{ processor.GetMemoryInput(younger) };
+		uint32_t laterAddress{ static_cast<uint32_t>(later.GetAluResult()) };
+
+		overwritten = overwritten || (later.GetMemWrite() && (laterAddress - address < size || address - laterAddress < MemAccessSize(later.GetControl())));
+	}
+
+	uint32_t val{ overwritten ? static_cast<uint32_t>(mem.GetSendBackValue()) & mask : mainMemory.Load(address, size) };
+
+	return RetiredEffect{ EffectKind::Store, address, val, size };
+}
+
+// Retired - what the instruction leaving write back changed, with the store it made in the memory stage
+template <class Trace>
+RetiredEffect CoSimulation<Trace>::Retired(const MEMWB & wb, const RetiredEffect & stored)
+{
+	if (wb.GetRegWrite() && wb.GetWriteRegNum() != 0x0)
+	{
+		uint32_t val{ static_cast<uint32_t>(wb.GetMemToReg() ? wb.GetLoadByteValue() : wb.GetAluResult()) };
+		return RetiredEffect{ EffectKind::Register, wb.GetWriteRegNum(), val, 0x4 };
+	}
+
+	if (wb.GetMemWrite()) { return stored; }
+
+	return RetiredEffect{ EffectKind::None, 0x0, 0x0, 0x0 };
+}
+
+template <class Trace>
+void CoSimulation<Trace>::Describe(std::ostream & out, const RetiredEffect & effect)
+{
+	switch (effect.kind)
+	{
+	case EffectKind::Register: out << "wrote $" << std::dec << effect.target << " = 0x" << std::hex << effect.value; break;
+	case EffectKind::Store: out << "stored " << std::dec << effect.size << " bytes 0x" << std::hex << effect.value << " at 0x" << effect.target; break;
+	case EffectKind::Unsupported: out << "does not implement the instruction"; break;
+	default: out << "changed nothing"; break;
+	}
+}
+
+// DescribeHistory - the last few instructions retired, oldest first, as hex pc and instruction words
+template <class Trace>
+void CoSimulation<Trace>::DescribeHistory(std::ostream & out) const
+{
+	uint64_t shown{ checked < COSIM_HISTORY ? checked : COSIM_HISTORY };
+
+	if (shown != 0x0) { out << "  retired before it:" << std::endl; }
+	for (uint64_t i{ checked - shown }; i < checked; ++i)
+	{
+		out << "    pc 0x" << std::hex << std::setfill('0') << std::setw(8) << historyPc[i % COSIM_HISTORY] << ", instruction 0x" << std::setw(8)
+			<< historyInstruction[i % COSIM_HISTORY] << std::endl;
+	}
+}
+
+//*****************************************************************
+// Diverge - describe the first difference: the cycle, which      *
+// retired instruction, what each side did, and the instructions  *
+// retired just before it                                         *
+//*****************************************************************
+template <class Trace>
+void CoSimulation<Trace>::Diverge(uint64_t cycle, uint32_t pc, uint32_t instruction, const RetiredEffect & pipeline,
+	const RetiredEffect & expected)
+{
+	std::ostringstream text;
+
+	text << "the pipeline diverged from the reference model at cycle " << cycle << ", retired instruction " << checked << std::endl;
+	text << "  pc 0x" << std::hex << std::setfill('0') << std::setw(8) << pc << ", instruction 0x" << std::setw(8) << instruction << ": the pipeline ";
+	Describe(text, pipeline);
+	text << ", the reference ";
+	Describe(text, expected);
+	text << std::endl;
+	DescribeHistory(text);
+
+	divergence = text.str();
+}
+
+//**************************************************************
+// Check - after a cycle, run what left write back on the       *
+// reference, oldest slot first, and compare, stopping at the   *
+// first difference or the first instruction the reference does *
+// not implement; then keep what the memory stage stored for    *
+// next cycle's compare                                         *
+//**************************************************************
+template <class Trace>
+template <class Config>
+void CoSimulation<Trace>::Check(const Processor<Config> & processor, const SparseMemory & mainMemory, uint64_t cycle)
+{
+	for (uint32_t slot{ 0x0 }; slot < processor.GetIssueWidth() && !HasDiverged(); ++slot)
+	{
+		const MEMWB & wb{ processor.GetWriteBackInput(slot) };
+
+		if (wb.IsBubble()) { continue; }
+
+		uint32_t pc{ reference.GetPc() };
+		uint32_t instruction{ Fetch(pc) };
+		RetiredEffect expected{ reference.Execute(instruction) };
+		RetiredEffect pipeline{ Retired(wb, stores[slot]) };
+
+		// an encoding the reference does not implement stops the run, whatever the pipeline made of it
+		if (!(pipeline == expected) || expected.kind == EffectKind::Unsupported) { Diverge(cycle, pc, instruction, pipeline, expected); }
+
+		historyPc[checked % COSIM_HISTORY] = pc;
+		historyInstruction[checked % COSIM_HISTORY] = instruction;
+		++checked;
+	}
+
+	for (uint32_t slot{ 0x0 }; slot < processor.GetIssueWidth(); ++slot) { stores[slot] = Stored(processor, slot, mainMemory); }
+}
+
+//***************************************************************
+// Finish - once the run ends, compare the register files, which *
+// hold exactly what retired; unless the cycle limit stopped it, *
+// the run has retired all it will, so the reference must have   *
+// run off the end of the trace too, or what is left was never   *
+// checked; returns false on any divergence                      *
+//***************************************************************
+template <class Trace>
+template <class Config>
+bool CoSimulation<Trace>::Finish(const Processor<Config> & processor, bool ended)
+{
+	for (uint32_t reg{ 0x0 }; reg < 0x20 && !HasDiverged(); ++reg)
+	{
+		if (processor.GetRegister(reg) == reference.GetRegister(reg)) { continue; }
+
+		std::ostringstream text;
+		text << "the pipeline's register file diverged from the reference model after " << checked << " instructions: $" << reg << " = 0x"
+			<< std::hex << processor.GetRegister(reg) << ", the reference has 0x" << reference.GetRegister(reg) << std::endl;
+		divergence = text.str();
+	}
+
+	uint32_t pc{ reference.GetPc() };
+	uint32_t instruction{ 0x0 };
+
+	if (!HasDiverged() && ended && trace.Seek(pc >> 2) && trace.Next(instruction))
+	{
+		std::ostringstream text;
+		text << "the run ended after " << checked << " retired instructions, but the reference model has more of the trace to run" << std::endl;
+		text << "  pc 0x" << std::hex << std::setfill('0') << std::setw(8) << pc << ", instruction 0x" << std::setw(8) << instruction
+			<< ": the pipeline never retired it" << std::endl;
+		DescribeHistory(text);
+		divergence = text.str();
+	}
+	position = UINT64_MAX; // the reads above moved the trace on
+
+	return !HasDiverged();
+}
+
+#endif
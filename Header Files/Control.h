@@ -0,0 +1,189 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include <cstdint>
+
+// control word bits - one packed word carries every control line
+const uint32_t
+	CTRL_ALU_SRC{ 0x00001 },
+	CTRL_MEM_READ{ 0x00002 },
+	CTRL_MEM_TO_REG{ 0x00004 },
+	CTRL_MEM_WRITE{ 0x00008 },
+	CTRL_REG_DEST{ 0x00010 },
+	CTRL_REG_WRITE{ 0x00020 },
+	CTRL_BUBBLE{ 0x00040 }, // no instruction - an empty slot or a stall, never counted as retired
+	CTRL_MEM_HALF{ 0x00080 }, // loads and stores move a halfword...
+	CTRL_ALU_OP_BM{ 0x00F00 }, // aluOp keeps its binary digits as a decimal number - 00, 01, 10 or 11
+	CTRL_MEM_WORD{ 0x01000 }, // ...or a word, a byte when neither is set
+	CTRL_BRANCH{ 0x02000 }, // beq/bne - resolved in execute
+	CTRL_JUMP{ 0x04000 }, // j/jal - resolved in decode
+	CTRL_JUMP_REG{ 0x08000 }, // jr - resolved in execute
+	CTRL_BRANCH_NE{ 0x10000 }, // the branch is taken on not equal
+	CTRL_LINK{ 0x20000 }, // the return address goes to $31
+	CTRL_ZERO_EXTEND{ 0x40000 }, // the immediate is zero extended rather than sign extended
+	CTRL_PREDICTED_TAKEN{ 0x80000 }, // fetch went on at the branch target - set by decode, never predecoded
+	CTRL_UNSUPPORTED{ 0x100000 }; // an encoding the simulator does not implement - run as a no-op, and counted in execute
+
+// control transfers - kept down to write back to classify the instruction as it retires
+const uint32_t CTRL_TRANSFER_BM{ CTRL_BRANCH | CTRL_JUMP | CTRL_JUMP_REG };
+
+const uint32_t CTRL_ALU_OP_SHIFT{ 8 };
+
+const uint32_t LINK_REG{ 0x1F }; // jal writes the return address here
+
+// ALU operations selected by the ALU control
+enum AluOperation : uint8_t
+{
+	ALU_NONE, // unsupported function - the instruction runs as an unsupported no-op
+	ALU_ADD,
+	ALU_SUB,
+	ALU_AND,
+	ALU_OR,
+	ALU_SLT, // set on signed less than
+	ALU_SLL, // shifts take the value as a and the shift amount as b
+	ALU_SRL,
+	ALU_LUI // b moved to the upper halfword
+};
+
+//***************************************************
+// MakeControl - pack the control lines into a word *
+//***************************************************
+constexpr uint32_t MakeControl(uint32_t aluOp, bool aluSrc, bool memRead, bool memToReg, bool memWrite, bool regDest, bool regWrite,
+	uint32_t extra = 0x0)
+{
+	return (aluOp << CTRL_ALU_OP_SHIFT) | (aluSrc ? CTRL_ALU_SRC : 0x0) | (memRead ? CTRL_MEM_READ : 0x0) |
+		(memToReg ? CTRL_MEM_TO_REG : 0x0) | (memWrite ? CTRL_MEM_WRITE : 0x0) | (regDest ? CTRL_REG_DEST : 0x0) |
+		(regWrite ? CTRL_REG_WRITE : 0x0) | extra;
+}
+
+const uint32_t NOOP_CONTROL{ MakeControl(00, 0, 0, 0, 0, 0, 0) };
+const uint32_t BUBBLE_CONTROL{ NOOP_CONTROL | CTRL_BUBBLE };
+const uint32_t JR_CONTROL{ MakeControl(00, 0, 0, 0, 0, 0, 0, CTRL_JUMP_REG) }; // jr is r-format, picked out by its function code
+const uint32_t UNSUPPORTED_CONTROL{ NOOP_CONTROL | CTRL_UNSUPPORTED };
+
+//***************************************************************
+// Control ROM - the control word for every opcode, generated  *
+// at compile time; opcodes not listed decode as unsupported   *
+// no-ops, which the run counts and warns about                *
+//***************************************************************
+struct ControlRom
+{
+	uint32_t words[0x40];
+};
+
+constexpr ControlRom BuildControlRom()
+{
+	ControlRom rom{};
+
+	for (uint32_t & word : rom.words) { word = UNSUPPORTED_CONTROL; }
+
+	rom.words[0x00] = MakeControl(10, 0, 0, 0, 0, 1, 1); // r-format
+	rom.words[0x02] = MakeControl(00, 0, 0, 0, 0, 0, 0, CTRL_JUMP); // jump
+	rom.words[0x03] = MakeControl(00, 1, 0, 0, 0, 1, 1, CTRL_JUMP | CTRL_LINK); // jump and link - $31 = return address + 0
+	rom.words[0x04] = MakeControl(01, 0, 0, 0, 0, 0, 0, CTRL_BRANCH); // branch on equal
+	rom.words[0x05] = MakeControl(01, 0, 0, 0, 0, 0, 0, CTRL_BRANCH | CTRL_BRANCH_NE); // branch on not equal
+	rom.words[0x08] = MakeControl(11, 1, 0, 0, 0, 0, 1); // add immediate
+	rom.words[0x09] = MakeControl(11, 1, 0, 0, 0, 0, 1); // add immediate unsigned - no overflow traps either way
+	rom.words[0x0A] = MakeControl(11, 1, 0, 0, 0, 0, 1); // set on less than immediate
+	rom.words[0x0C] = MakeControl(11, 1, 0, 0, 0, 0, 1, CTRL_ZERO_EXTEND); // and immediate
+	rom.words[0x0D] = MakeControl(11, 1, 0, 0, 0, 0, 1, CTRL_ZERO_EXTEND); // or immediate
+	rom.words[0x0F] = MakeControl(11, 1, 0, 0, 0, 0, 1); // load upper immediate
+	rom.words[0x20] = MakeControl(00, 1, 1, 1, 0, 0, 1); // load byte
+	rom.words[0x21] = MakeControl(00, 1, 1, 1, 0, 0, 1, CTRL_MEM_HALF); // load halfword
+	rom.words[0x23] = MakeControl(00, 1, 1, 1, 0, 0, 1, CTRL_MEM_WORD); // load word
+	rom.words[0x28] = MakeControl(00, 1, 0, 0, 1, 0, 0); // store byte - memToReg and regDest don't matter, treated as 0
+	rom.words[0x29] = MakeControl(00, 1, 0, 0, 1, 0, 0, CTRL_MEM_HALF); // store halfword
+	rom.words[0x2B] = MakeControl(00, 1, 0, 0, 1, 0, 0, CTRL_MEM_WORD); // store word
+
+	return rom;
+}
+
+constexpr ControlRom CONTROL_ROM{ BuildControlRom() };
+
+//*****************************************************************
+// ALU table - the ALU operation for every r-format function code *
+// and, for aluOp 11, every immediate opcode                      *
+//*****************************************************************
+struct AluTable
+{
+	AluOperation operations[0x40];
+	AluOperation immediates[0x40];
+};
+
+constexpr AluTable BuildAluTable()
+{
+	AluTable table{};
+
+	table.operations[0x00] = ALU_SLL; // shift left logical
+	table.operations[0x02] = ALU_SRL; // shift right logical
+	table.operations[0x20] = ALU_ADD; // add
+	table.operations[0x21] = ALU_ADD; // add unsigned
+	table.operations[0x22] = ALU_SUB; // subtract
+	table.operations[0x23] = ALU_SUB; // subtract unsigned
+	table.operations[0x24] = ALU_AND; // and
+	table.operations[0x25] = ALU_OR; // or
+	table.operations[0x2A] = ALU_SLT; // set on less than
+
+	table.immediates[0x08] = ALU_ADD; // addi
+	table.immediates[0x09] = ALU_ADD; // addiu
+	table.immediates[0x0A] = ALU_SLT; // slti
+	table.immediates[0x0C] = ALU_AND; // andi
+	table.immediates[0x0D] = ALU_OR; // ori
+	table.immediates[0x0F] = ALU_LUI; // lui
+
+	return table;
+}
+
+constexpr AluTable ALU_TABLE{ BuildAluTable() };
+
+//******************************************************************
+// AluControl - the ALU operation for an aluOp/function pair: the  *
+// function field is only consulted for r-format (aluOp 10), the   *
+// opcode only for immediate instructions (aluOp 11)               *
+//******************************************************************
+constexpr AluOperation AluControl(uint32_t aluOp, uint32_t function, uint32_t opcode)
+{
+	return aluOp == 10 ? ALU_TABLE.operations[function] : (aluOp == 11 ? ALU_TABLE.immediates[opcode] : (aluOp == 01 ? ALU_SUB : ALU_ADD));
+}
+
+constexpr bool IsShift(AluOperation operation) { return operation == ALU_SLL || operation == ALU_SRL; }
+
+//*************************************
+// Alu - perform an ALU operation     *
+//*************************************
+inline int32_t Alu(AluOperation operation, int32_t a, int32_t b)
+{
+	switch (operation)
+	{
+	case ALU_ADD: return static_cast<int32_t>(static_cast<uint32_t>(a) + static_cast<uint32_t>(b));
+	case ALU_SUB: return static_cast<int32_t>(static_cast<uint32_t>(a) - static_cast<uint32_t>(b));
+	case ALU_AND: return a & b;
+	case ALU_OR: return a | b;
+	case ALU_SLT: return a < b ? 0x1 : 0x0;
+	case ALU_SLL: return static_cast<int32_t>(static_cast<uint32_t>(a) << (b & 0x1F));
+	case ALU_SRL: return static_cast<int32_t>(static_cast<uint32_t>(a) >> (b & 0x1F));
+	case ALU_LUI: return static_cast<int32_t>(static_cast<uint32_t>(b) << 16);
+	default: return 0x0;
+	}
+}
+
+//*****************************************************************
+// MemAccessSize - bytes a load or store moves: 1, 2 or 4          *
+//*****************************************************************
+constexpr uint32_t MemAccessSize(uint32_t control)
+{
+	return (control & CTRL_MEM_WORD) != 0x0 ? 0x4 : ((control & CTRL_MEM_HALF) != 0x0 ? 0x2 : 0x1);
+}
+
+// ExtendLoad - sign extend a loaded byte or halfword to the register width
+constexpr int32_t ExtendLoad(uint32_t val, uint32_t control)
+{
+	return (control & CTRL_MEM_WORD) != 0x0 ? static_cast<int32_t>(val) :
+		((control & CTRL_MEM_HALF) != 0x0 ? static_cast<int16_t>(val) : static_cast<int8_t>(val));
+}
+
+// branch and jump targets, from the address of the instruction after the branch or jump
+constexpr uint32_t BranchTarget(uint32_t nextPc, uint32_t seOffset) { return nextPc + (seOffset << 2); }
+constexpr uint32_t JumpTarget(uint32_t nextPc, uint32_t index) { return (nextPc & 0xF0000000) | index; }
+
+#endif
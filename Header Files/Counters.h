@@ -0,0 +1,122 @@
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include "Options.h"
+
+//*******************************************************************
+// Performance counters - bumped by the stage functions as the run *
+// goes; instructions count as retired when they leave write back  *
+//*******************************************************************
+struct PerformanceCounters
+{
+	uint64_t cycles{ 0x0 };
+	uint64_t retiredRFormat{ 0x0 }, retiredLoads{ 0x0 }, retiredStores{ 0x0 }, retiredNoops{ 0x0 }; // r-format counts every ALU result, immediates too; loads and stores of every size
+	uint64_t retiredBranches{ 0x0 }; // branches and jumps
+	uint64_t bubbles{ 0x0 }; // decode stalls, each sends one bubble down the pipeline
+	uint64_t takenBranches{ 0x0 }; // branches taken and jumps, resolved in execute
+	uint64_t conditionalBranches{ 0x0 }, mispredictions{ 0x0 }; // branches resolved in execute, and those fetch guessed wrong
+	uint64_t flushes{ 0x0 }; // wrong path instructions squashed by a redirect, one fetch cycle lost each
+	uint64_t forwards{ 0x0 }; // operands taken from EX/MEM or MEM/WB instead of the register file
+	uint64_t memoryReads{ 0x0 }, memoryWrites{ 0x0 };
+	uint64_t registerWrites{ 0x0 }; // register file write backs
+	uint64_t dcacheHits{ 0x0 }, dcacheMisses{ 0x0 }, dcacheWritebacks{ 0x0 };
+	uint64_t memoryStallCycles{ 0x0 }; // cycles the whole pipeline waited on the data cache
+	uint64_t fastForwarded{ 0x0 }; // instructions executed functionally, outside the pipeline and the other counters
+	uint64_t unsupported{ 0x0 }; // encodings the simulator does not implement, run as no-ops in execute or fast forwarding
+
+	uint64_t GetRetired() const { return retiredRFormat + retiredLoads + retiredStores + retiredNoops + retiredBranches; }
+	double GetCpi() const { return GetRetired() == 0x0 ? 0.0 : static_cast<double>(cycles) / GetRetired(); }
+	double GetBranchAccuracy() const
+	{
+		return conditionalBranches == 0x0 ? 1.0 : static_cast<double>(conditionalBranches - mispredictions) / conditionalBranches;
+	}
+};
+
+//*************************************************************
+// JsonString - quote a string for JSON, escaping quotes and  *
+// backslashes, and control characters as \u00XX              *
+//*************************************************************
+static std::string JsonString(const std::string & text)
+{
+	const char * digits{ "0123456789abcdef" };
+	std::string quoted{ "\"" };
+
+	for (char c : text)
+	{
+		unsigned char byte{ static_cast<unsigned char>(c) };
+
+		if (byte < 0x20)
+		{
+			quoted += "\\u00";
+			quoted += digits[byte >> 4];
+			quoted += digits[byte & 0xF];
+			continue;
+		}
+
+		if (c == '"' || c == '\\') { quoted += '\\'; }
+		quoted += c;
+	}
+
+	return quoted + '"';
+}
+
+//************************************************************
+// CsvString - quote a string for CSV, doubling any quotes  *
+//************************************************************
+static std::string CsvString(const std::string & text)
+{
+	std::string quoted{ "\"" };
+
+	for (char c : text)
+	{
+		if (c == '"') { quoted += '"'; }
+		quoted += c;
+	}
+
+	return quoted + '"';
+}
+
+//******************************************************************
+// WriteCounters - emit the run summary as one JSON object, or as *
+// a CSV row after the header, so runs can be compared by a       *
+// script; reports of many runs write the CSV header only once    *
+//******************************************************************
+void WriteCounters(std::ostream & out, StatsFormat format, const std::string & workload, const PerformanceCounters & counters,
+	bool header = true)
+{
+	const char * names[]{ "cycles", "retired", "retired_rformat", "retired_load", "retired_store", "retired_noop",
+		"retired_branch", "bubbles", "taken_branches", "conditional_branches", "mispredictions", "flushes", "forwards",
+		"memory_reads", "memory_writes", "register_writes", "dcache_hits", "dcache_misses", "dcache_writebacks",
+		"memory_stall_cycles", "fast_forwarded", "unsupported" };
+	const uint64_t values[]{ counters.cycles, counters.GetRetired(), counters.retiredRFormat, counters.retiredLoads,
+		counters.retiredStores, counters.retiredNoops, counters.retiredBranches, counters.bubbles, counters.takenBranches,
+		counters.conditionalBranches, counters.mispredictions, counters.flushes, counters.forwards, counters.memoryReads,
+		counters.memoryWrites, counters.registerWrites, counters.dcacheHits, counters.dcacheMisses, counters.dcacheWritebacks,
+		counters.memoryStallCycles, counters.fastForwarded, counters.unsupported };
+	const size_t count{ sizeof(values) / sizeof(values[0]) };
+
+	if (format == StatsFormat::Json)
+	{
+		out << "{\"workload\": " << JsonString(workload);
+		for (size_t i{ 0x0 }; i < count; ++i) { out << ", \"" << names[i] << "\": " << values[i]; }
+		out << ", \"cpi\": " << counters.GetCpi() << ", \"branch_accuracy\": " << counters.GetBranchAccuracy() << '}' << std::endl;
+	}
+	else
+	{
+		if (header)
+		{
+			out << "workload";
+			for (size_t i{ 0x0 }; i < count; ++i) { out << ',' << names[i]; }
+			out << ",cpi,branch_accuracy" << std::endl;
+		}
+
+		out << CsvString(workload);
+		for (size_t i{ 0x0 }; i < count; ++i) { out << ',' << values[i]; }
+		out << ',' << counters.GetCpi() << ',' << counters.GetBranchAccuracy() << std::endl;
+	}
+}
+
+#endif
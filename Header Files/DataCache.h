@@ -0,0 +1,206 @@
+#ifndef DATACACHE_H
+#define DATACACHE_H
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+#include "Checkpoint.h"
+#include "Options.h"
+
+//***************************************************************
+// Cache line - tag and state only, the data itself stays in    *
+// main memory, so the cache models timing and never the values *
+//***************************************************************
+struct CacheLine
+{
+	uint32_t tag;
+	uint64_t lastUse; // access clock of the last hit or fill, for LRU
+	bool valid, dirty;
+};
+
+//*******************************************************************
+// Data cache - set associative, sitting between the memory stage  *
+// and main memory; Access returns the extra cycles the access     *
+// stalls the pipeline for, 0 for a plain hit                      *
+//*******************************************************************
+class DataCache
+{
+private:
+	CacheConfig config;
+	std::vector<CacheLine> lines; // sets * ways, the ways of a set side by side
+	uint32_t offsetBits, setMask, setBits;
+	uint64_t clock, state; // access clock and random replacement state
+	uint64_t hits, misses, writebacks;
+
+	static bool IsPowerOfTwo(uint32_t val) { return val != 0x0 && (val & (val - 0x1)) == 0x0; }
+	static uint32_t Log2(uint32_t);
+	static bool IsValid(const CacheConfig &);
+	CacheLine & Victim(CacheLine *);
+public:
+	DataCache();
+	bool Configure(const CacheConfig &);
+	uint32_t Access(uint32_t, bool);
+
+	bool IsEnabled() const { return !lines.empty(); }
+	uint64_t GetHits() const { return hits; }
+	uint64_t GetMisses() const { return misses; }
+	uint64_t GetWritebacks() const { return writebacks; }
+
+	void Save(std::ostream &) const;
+	bool Load(std::istream &);
+};
+
+DataCache::DataCache()
+{
+	offsetBits = setMask = setBits = 0x0;
+	clock = 0x0;
+	state = 0x1;
+	hits = misses = writebacks = 0x0;
+}
+
+uint32_t DataCache::Log2(uint32_t val)
+{
+	uint32_t bits{ 0x0 };
+	while (val > 0x1) { val >>= 1; ++bits; }
+	return bits;
+}
+
+//****************************************************************
+// IsValid - true if the geometry is no cache, or powers of two  *
+// that divide evenly into a power of two number of sets         *
+//****************************************************************
+bool DataCache::IsValid(const CacheConfig & geometry)
+{
+	if (geometry.size == 0x0) { return true; }
+
+	if (!IsPowerOfTwo(geometry.size) || !IsPowerOfTwo(geometry.lineSize) || geometry.lineSize < 0x4 ||
+		geometry.ways == 0x0 || geometry.size % (geometry.lineSize * geometry.ways) != 0x0)
+	{
+		return false;
+	}
+
+	return IsPowerOfTwo(geometry.size / (geometry.lineSize * geometry.ways));
+}
+
+//******************************************************************
+// Configure - size the cache, returns false if the geometry is   *
+// not a power of two or does not divide evenly into sets         *
+//******************************************************************
+bool DataCache::Configure(const CacheConfig & cacheConfig)
+{
+	config = cacheConfig;
+	lines.clear();
+
+	if (config.size == 0x0) { return true; } // no cache - every access goes straight to main memory
+	if (!IsValid(config)) { return false; }
+
+	uint32_t sets{ config.size / (config.lineSize * config.ways) };
+	offsetBits = Log2(config.lineSize);
+	setBits = Log2(sets);
+	setMask = sets - 0x1;
+	lines.assign(static_cast<size_t>(sets) * config.ways, CacheLine{ 0x0, 0x0, false, false });
+
+	return true;
+}
+
+// pick the way to fill - an invalid one if there is one, otherwise by the replacement policy
+CacheLine & DataCache::Victim(CacheLine * set)
+{
+	CacheLine * victim{ set };
+
+	for (uint32_t i{ 0x0 }; i < config.ways; ++i)
+	{
+		if (!set[i].valid) { return set[i]; }
+		if (set[i].lastUse < victim->lastUse) { victim = &set[i]; }
+	}
+
+	if (config.replacement == CacheReplacement::Random)
+	{
+		state ^= state << 13; // xorshift64
+		state ^= state >> 7;
+		state ^= state << 17;
+		victim = &set[state % config.ways];
+	}
+
+	return *victim;
+}
+
+//****************************************************************
+// Access - look up a byte address, filling the line on a miss;  *
+// write-back caches allocate on writes and mark the line dirty, *
+// write-through caches send writes on through a write buffer    *
+// and only allocate on reads                                    *
+//****************************************************************
+uint32_t DataCache::Access(uint32_t address, bool write)
+{
+	uint32_t line{ address >> offsetBits }, tag{ line >> setBits };
+	CacheLine * set{ &lines[static_cast<size_t>(line & setMask) * config.ways] };
+
+	++clock;
+	for (uint32_t i{ 0x0 }; i < config.ways; ++i)
+	{
+		if (set[i].valid && set[i].tag == tag)
+		{
+			set[i].lastUse = clock;
+			set[i].dirty = set[i].dirty || (write && config.writePolicy == CacheWritePolicy::WriteBack);
+			++hits;
+			return config.hitLatency;
+		}
+	}
+
+	++misses;
+	if (write && config.writePolicy == CacheWritePolicy::WriteThrough) { return config.hitLatency; }
+
+	CacheLine & victim{ Victim(set) };
+	uint32_t latency{ config.hitLatency + config.missPenalty };
+
+	if (victim.valid && victim.dirty) // the evicted line goes back to memory first
+	{
+		++writebacks;
+		latency += config.missPenalty;
+	}
+
+	victim = CacheLine{ tag, clock, true, write };
+
+	return latency;
+}
+
+//***************************************************************
+// Save - write the geometry and every line, so a restore with *
+// the same geometry continues with a warm cache               *
+//***************************************************************
+void DataCache::Save(std::ostream & out) const
+{
+	WriteRaw(out, config);
+	WriteRaw(out, clock);
+	WriteRaw(out, state);
+
+	for (const CacheLine & line : lines) { WriteRaw(out, line); }
+}
+
+//*****************************************************************
+// Load - read a cache written by Save; when its geometry differs  *
+// from the configured one it is skipped and the cache stays cold; *
+// returns false if it ends early or its geometry is not valid     *
+//*****************************************************************
+bool DataCache::Load(std::istream & in)
+{
+	CacheConfig saved;
+
+	if (!ReadRaw(in, saved) || !ReadRaw(in, clock) || !ReadRaw(in, state) || !IsValid(saved)) { return false; }
+
+	uint32_t savedLines{ saved.size == 0x0 ? 0x0 : saved.size / saved.lineSize };
+	bool same{ saved.size == config.size && saved.lineSize == config.lineSize && saved.ways == config.ways };
+
+	for (uint32_t i{ 0x0 }; i < savedLines; ++i)
+	{
+		CacheLine line;
+		if (!ReadRaw(in, line)) { return false; }
+		if (same) { lines[i] = line; }
+	}
+
+	return true;
+}
+
+#endif
@@ -2,33 +2,40 @@
 #define EXMEM_H
 
 #include <cstdint>
+#include "Control.h"
+
+const uint32_t EXMEM_CONTROL_BM{ CTRL_MEM_READ | CTRL_MEM_TO_REG | CTRL_MEM_WRITE | CTRL_REG_WRITE | CTRL_BUBBLE |
+	CTRL_MEM_HALF | CTRL_MEM_WORD | CTRL_TRANSFER_BM };
+
+static_assert(EXMEM_CONTROL_BM <= 0xFFFF, "EX/MEM control lines must fit in 16 bits");
 
 //****************************************************************************************************
 // EX/MEM pipeline register for control lines, ALU calculated values, and write back register number *
+// - memRead, memToReg, memWrite, regWrite, bubble, the access size and the control transfer bits   *
+//   keep their control word bits (see Control.h), in 16 bits as all of them are below 0x10000      *
 //****************************************************************************************************
 class EXMEM
 {
 private:
-	bool memRead, memToReg, memWrite, reg_write; // control lines
-	int32_t aluResult, storeByteValue; // calculated values
-	uint32_t writeRegNum; // write back register number
+	int32_t aluResult, storeByteValue; // calculated values - the store value is a byte, halfword or word
+	uint16_t control; // control lines
+	uint8_t writeRegNum; // write back register number
 public:
 	EXMEM(); // constructor - initializes values
 
 	// mutators
-	void SetMemRead(bool val) { memRead = val; }
-	void SetMemToReg(bool val) { memToReg = val; }
-	void SetMemWrite(bool val) { memWrite = val; }
-	void SetRegWrite(bool val) { reg_write = val; }
+	void SetControl(uint32_t val) { control = static_cast<uint16_t>(val & EXMEM_CONTROL_BM); }
 	void SetAluResult(int32_t val) { aluResult = val; }
 	void SetSendBackValue(int32_t val) { storeByteValue = val; }
-	void SetWriteRegNum(uint32_t val) { writeRegNum = val; }
+	void SetWriteRegNum(uint32_t val) { writeRegNum = static_cast<uint8_t>(val); }
 
 	// accessors
-	bool GetMemRead() const { return memRead; }
-	bool GetMemToReg() const { return memToReg; }
-	bool GetMemWrite() const { return memWrite; }
-	bool GetRegWrite() const { return reg_write; }
+	uint32_t GetControl() const { return control; }
+	bool GetMemRead() const { return (control & CTRL_MEM_READ) != 0x0; }
+	bool GetMemToReg() const { return (control & CTRL_MEM_TO_REG) != 0x0; }
+	bool GetMemWrite() const { return (control & CTRL_MEM_WRITE) != 0x0; }
+	bool GetRegWrite() const { return (control & CTRL_REG_WRITE) != 0x0; }
+	bool IsBubble() const { return (control & CTRL_BUBBLE) != 0x0; }
 	int32_t GetAluResult() const { return aluResult; }
 	int32_t GetSendBackValue() const { return storeByteValue; }
 	uint32_t GetWriteRegNum() const { return writeRegNum; }
@@ -36,9 +43,9 @@ public:
 
 EXMEM::EXMEM() // ctor - initializes pipeline register values
 {
-	memRead = memToReg = memWrite = reg_write = 0x0;
+	control = BUBBLE_CONTROL;
 	aluResult = storeByteValue = 0x0;
 	writeRegNum = 0x0;
 }
 
-#endif
\ No newline at end of file
+#endif
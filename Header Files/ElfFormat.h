@@ -0,0 +1,66 @@
+#ifndef ELFFORMAT_H
+#define ELFFORMAT_H
+
+#include <cstdint>
+
+//**************************************************************************
+// ELF32 file, program and section headers, as laid out in the file; the  *
+// fields are in the byte order ELF_DATA names, so read them through      *
+// ElfField                                                               *
+//**************************************************************************
+struct Elf32Header
+{
+	uint8_t ident[16]; // ELF_MAGIC, class, byte order, version...
+	uint16_t type, machine;
+	uint32_t version, entry, phoff, shoff, flags;
+	uint16_t ehsize, phentsize, phnum, shentsize, shnum, shstrndx;
+};
+
+struct Elf32ProgramHeader
+{
+	uint32_t type, offset, vaddr, paddr, filesz, memsz, flags, align;
+};
+
+struct Elf32SectionHeader
+{
+	uint32_t name, type, flags, addr, offset, size, link, info, addralign, entsize;
+};
+
+static_assert(sizeof(Elf32Header) == 52, "ELF32 header layout must not change");
+static_assert(sizeof(Elf32ProgramHeader) == 32, "ELF32 program header layout must not change");
+static_assert(sizeof(Elf32SectionHeader) == 40, "ELF32 section header layout must not change");
+
+const char ELF_MAGIC[4]{ '\x7F', 'E', 'L', 'F' };
+
+const uint32_t
+	ELF_CLASS{ 4 }, // ident byte holding the class...
+	ELF_CLASS_32{ 1 },
+	ELF_DATA{ 5 }, // ...and the byte order
+	ELF_DATA_LSB{ 1 },
+	ELF_DATA_MSB{ 2 },
+	ELF_TYPE_EXEC{ 2 },
+	ELF_MACHINE_MIPS{ 8 },
+	ELF_SEGMENT_LOAD{ 1 },
+	ELF_SEGMENT_EXECUTE{ 0x1 }, // program header flag of a segment holding code
+	ELF_SECTION_EXECUTE{ 0x4 }; // section header flag of a section holding instructions, rather than constants
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+const bool HOST_BIG_ENDIAN{ true };
+#else
+const bool HOST_BIG_ENDIAN{ false };
+#endif
+
+// an ELF field in host order, from a file in big (MIPS) or little (MIPSel) byte order
+inline uint32_t ElfField(uint32_t field, bool bigEndian)
+{
+	if (bigEndian == HOST_BIG_ENDIAN) { return field; }
+	return (field >> 24) | ((field >> 8) & 0xFF00) | ((field << 8) & 0xFF0000) | (field << 24);
+}
+
+inline uint16_t ElfField(uint16_t field, bool bigEndian)
+{
+	if (bigEndian == HOST_BIG_ENDIAN) { return field; }
+	return static_cast<uint16_t>((field >> 8) | (field << 8));
+}
+
+#endif
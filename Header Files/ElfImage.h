@@ -0,0 +1,274 @@
+#ifndef ELFIMAGE_H
+#define ELFIMAGE_H
+
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include "ElfFormat.h"
+#include "Instruction.h"
+#include "MappedFile.h"
+#include "SparseMemory.h"
+
+const uint32_t ELF_STACK_TOP{ 0x7FFFFFF0 }; // $sp of an ELF program, growing down from the top of user space
+const uint32_t STACK_REG{ 0x1D };
+
+//*********************************************************************
+// ELF image - memory maps a statically linked ELF32 MIPS executable, *
+// big or little-endian, and exposes the executable segment holding   *
+// its entry point in place as the instruction memory, without        *
+// copying it; every loadable segment is copied into main memory,     *
+// and untouched main memory already reads as the zeroed .bss         *
+// - branch delay slots are not modelled: fetch goes straight on to   *
+//   a branch or jump target, so an executable is only taken if the   *
+//   slot after every branch and jump in its code holds a nop, which  *
+//   then runs the same either way                                    *
+//*********************************************************************
+class ElfImage
+{
+private:
+	MappedFile file;
+	bool bigEndian;
+	uint32_t entry;
+	const Elf32ProgramHeader * segments;
+	uint32_t segmentCount;
+	const uint8_t * text; // the executable segment, still in the file's byte order
+	uint32_t textBase, textWords;
+
+	uint32_t Field(uint32_t field) const { return ElfField(field, bigEndian); }
+	uint16_t Field(uint16_t field) const { return ElfField(field, bigEndian); }
+	bool CheckDelaySlots(uint32_t, uint32_t, const std::string &) const;
+	bool CheckCode(const Elf32Header &, const std::string &) const;
+
+	static bool IsControlTransfer(uint32_t);
+	static bool IsNoop(uint32_t word) { return (word & (OPCODE_BM | WRITE_REG_15_11_BM | FUNCTION_BM)) == 0x0; } // sll into $0
+public:
+	ElfImage() : bigEndian(true), entry(0x0), segments(nullptr), segmentCount(0x0), text(nullptr), textBase(0x0), textWords(0x0) {}
+	bool Open(const std::string &);
+	bool SeedMemory(SparseMemory &) const;
+
+	uint32_t GetEntry() const { return entry; }
+	uint32_t GetTextBase() const { return textBase; }
+	uint32_t GetTextWords() const { return textWords; }
+
+	// instruction word i of the executable segment, in host order
+	uint32_t GetTextWord(uint32_t i) const
+	{
+		uint32_t word;
+		memcpy(&word, text + static_cast<size_t>(i) * sizeof(uint32_t), sizeof(word));
+		return Field(word);
+	}
+
+	static bool IsElf(const char *, size_t);
+};
+
+//**************************************************************
+// IsElf - true if the leading bytes carry the ELF magic       *
+//**************************************************************
+bool ElfImage::IsElf(const char * bytes, size_t count)
+{
+	return count >= sizeof(ELF_MAGIC) && memcmp(bytes, ELF_MAGIC, sizeof(ELF_MAGIC)) == 0;
+}
+
+//*****************************************************************
+// Open - map the executable and validate its headers and         *
+// segments against the file size, returns false (with a message) *
+// if it is not something the simulator can run                   *
+//*****************************************************************
+bool ElfImage::Open(const std::string & filename)
+{
+	if (!file.Open(filename))
+	{
+		std::cerr << "Error: unable to map input executable: " << filename << std::endl;
+		return false;
+	}
+
+	const Elf32Header * header{ reinterpret_cast<const Elf32Header *>(file.GetData()) };
+	if (file.GetSize() < sizeof(Elf32Header) || !IsElf(reinterpret_cast<const char *>(header->ident), sizeof(header->ident)) ||
+		header->ident[ELF_CLASS] != ELF_CLASS_32 || (header->ident[ELF_DATA] != ELF_DATA_LSB && header->ident[ELF_DATA] != ELF_DATA_MSB))
+	{
+		std::cerr << "Error: not an ELF32 file: " << filename << std::endl;
+		return false;
+	}
+
+	bigEndian = header->ident[ELF_DATA] == ELF_DATA_MSB;
+	if (Field(header->machine) != ELF_MACHINE_MIPS || Field(header->type) != ELF_TYPE_EXEC)
+	{
+		std::cerr << "Error: not a MIPS executable: " << filename << std::endl;
+		return false;
+	}
+
+	// the mapping is page aligned, so an aligned table offset keeps the program headers aligned too
+	uint32_t offset{ Field(header->phoff) };
+	entry = Field(header->entry);
+	segmentCount = Field(header->phnum);
+	if (Field(header->phentsize) != sizeof(Elf32ProgramHeader) || offset % sizeof(uint32_t) != 0x0 ||
+		offset + static_cast<uint64_t>(segmentCount) * sizeof(Elf32ProgramHeader) > file.GetSize())
+	{
+		std::cerr << "Error: truncated ELF program headers: " << filename << std::endl;
+		return false;
+	}
+
+	segments = reinterpret_cast<const Elf32ProgramHeader *>(file.GetData() + offset);
+
+	for (uint32_t i{ 0x0 }; i < segmentCount; ++i)
+	{
+		const Elf32ProgramHeader & segment{ segments[i] };
+		uint32_t base{ Field(segment.vaddr) }, size{ Field(segment.filesz) };
+
+		if (Field(segment.type) != ELF_SEGMENT_LOAD) { continue; }
+
+		if (static_cast<uint64_t>(Field(segment.offset)) + size > file.GetSize() || size > Field(segment.memsz) ||
+			static_cast<uint64_t>(base) + Field(segment.memsz) > 0x100000000ULL)
+		{
+			std::cerr << "Error: ELF segment does not fit in the file or main memory: " << filename << std::endl;
+			return false;
+		}
+
+		if ((Field(segment.flags) & ELF_SEGMENT_EXECUTE) != 0x0 && entry >= base && entry < base + size)
+		{
+			text = file.GetData() + Field(segment.offset);
+			textBase = base;
+			textWords = size / sizeof(uint32_t);
+		}
+	}
+
+	if (text == nullptr || textBase % sizeof(uint32_t) != 0x0 || entry % sizeof(uint32_t) != 0x0)
+	{
+		std::cerr << "Error: the ELF entry point is not in a word aligned executable segment: " << filename << std::endl;
+		return false;
+	}
+
+	return CheckCode(*header, filename);
+}
+
+//******************************************************************
+// IsControlTransfer - true for every MIPS I and II branch and     *
+// jump, the ones the pipeline implements or not, as each has a    *
+// delay slot                                                      *
+//******************************************************************
+bool ElfImage::IsControlTransfer(uint32_t word)
+{
+	uint32_t opcode{ (word & OPCODE_BM) >> OPCODE_SHIFT };
+	uint32_t rs{ (word & READ_REG1_BM) >> READ_REG1_SHIFT }, rt{ (word & READ_REG2_BM) >> READ_REG2_SHIFT };
+
+	switch (opcode)
+	{
+	case 0x00: return (word & FUNCTION_BM) == JR_FUNCTION || (word & FUNCTION_BM) == JALR_FUNCTION;
+	case 0x01: return (rt & 0x0C) == 0x0; // bltz, bgez, bltzal, bgezal and their likely forms, not the traps
+	case 0x02: case 0x03: case 0x04: case 0x05: case 0x06: case 0x07: return true; // j, jal, beq, bne, blez, bgtz
+	case 0x10: case 0x11: case 0x12: case 0x13: return rs == 0x08; // coprocessor condition branches
+	case 0x14: case 0x15: case 0x16: case 0x17: return true; // branch likely forms
+	default: return false;
+	}
+}
+
+//*****************************************************************
+// CheckDelaySlots - refuse the executable (with a message) if a  *
+// branch or jump among count code words from word first of the   *
+// executable segment has anything but a nop in its delay slot    *
+//*****************************************************************
+bool ElfImage::CheckDelaySlots(uint32_t first, uint32_t count, const std::string & filename) const
+{
+	for (uint32_t i{ first }; i < first + count; ++i)
+	{
+		if (!IsControlTransfer(GetTextWord(i)) || (i + 0x1 < textWords && IsNoop(GetTextWord(i + 0x1)))) { continue; }
+
+		std::cerr << "Error: the branch or jump at 0x" << std::hex << std::setfill('0') << std::setw(8) << textBase + i * sizeof(uint32_t) << std::dec;
+		std::cerr << " has an instruction in its delay slot, and delay slots are not modelled;" << std::endl;
+		std::cerr << "every branch and jump must be followed by a nop: " << filename << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+//******************************************************************
+// CheckCode - check the delay slots of every code section of the  *
+// executable segment, skipping the constants linked in with them; *
+// without section headers the whole segment is taken as code      *
+//******************************************************************
+bool ElfImage::CheckCode(const Elf32Header & header, const std::string & filename) const
+{
+	uint32_t offset{ Field(header.shoff) }, count{ Field(header.shnum) };
+
+	if (offset == 0x0 || count == 0x0 || Field(header.shentsize) != sizeof(Elf32SectionHeader) || offset % sizeof(uint32_t) != 0x0 ||
+		offset + static_cast<uint64_t>(count) * sizeof(Elf32SectionHeader) > file.GetSize())
+	{
+		return CheckDelaySlots(0x0, textWords, filename);
+	}
+
+	const Elf32SectionHeader * sections{ reinterpret_cast<const Elf32SectionHeader *>(file.GetData() + offset) };
+	uint64_t textEnd{ textBase + static_cast<uint64_t>(textWords) * sizeof(uint32_t) };
+
+	for (uint32_t i{ 0x0 }; i < count; ++i)
+	{
+		uint32_t base{ Field(sections[i].addr) }, size{ Field(sections[i].size) };
+
+		if ((Field(sections[i].flags) & ELF_SECTION_EXECUTE) == 0x0 || base < textBase || base + static_cast<uint64_t>(size) > textEnd) { continue; }
+
+		if (!CheckDelaySlots((base - textBase) / sizeof(uint32_t), size / sizeof(uint32_t), filename)) { return false; }
+	}
+
+	return true;
+}
+
+//*******************************************************************
+// SeedMemory - copy every loadable segment into main memory as it *
+// is laid out in the file, so loads see the program's data and    *
+// constants, and switch main memory to the executable's byte      *
+// order for the halves and words the program reads and writes     *
+//*******************************************************************
+bool ElfImage::SeedMemory(SparseMemory & mainMemory) const
+{
+	mainMemory.SetBigEndian(bigEndian);
+
+	for (uint32_t i{ 0x0 }; i < segmentCount; ++i)
+	{
+		const Elf32ProgramHeader & segment{ segments[i] };
+		const uint8_t * bytes{ file.GetData() + Field(segment.offset) };
+		uint32_t base{ Field(segment.vaddr) }, size{ Field(segment.filesz) };
+
+		if (Field(segment.type) != ELF_SEGMENT_LOAD) { continue; }
+
+		mainMemory.StoreBlock(base, bytes, size);
+	}
+
+	return true;
+}
+
+//*******************************************************************
+// ELF trace reader - hands the mapped executable segment to the   *
+// fetch stage one word at a time, same interface as TraceReader;  *
+// trace positions stay word addresses, so fetch runs off the end  *
+// of the program when pc leaves the executable segment             *
+//*******************************************************************
+class ElfTraceReader
+{
+private:
+	const ElfImage & image;
+	uint64_t first, last, position; // word addresses, last one past the end
+public:
+	explicit ElfTraceReader(const ElfImage & elf) : image(elf)
+	{
+		first = position = image.GetTextBase() >> 2;
+		last = first + image.GetTextWords();
+	}
+
+	bool Next(uint32_t & instruction)
+	{
+		if (position >= last) { return false; }
+		instruction = image.GetTextWord(static_cast<uint32_t>(position++ - first));
+		return true;
+	}
+
+	bool Seek(uint64_t target)
+	{
+		if (target < first || target > last) { return false; }
+		position = target;
+		return true;
+	}
+};
+
+#endif
@@ -0,0 +1,216 @@
+#ifndef EVENTTRACE_H
+#define EVENTTRACE_H
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "IFID.h"
+#include "IDEX.h"
+#include "OutputSink.h"
+
+// pipeline stages, one trace viewer track each
+enum PipelineStage : uint8_t { STAGE_IF, STAGE_ID, STAGE_EX, STAGE_MEM, STAGE_WB, STAGES };
+
+//*****************************************************************
+// Pipeline event - one instruction (or bubble) holding one stage *
+// from cycle start for duration cycles                           *
+//*****************************************************************
+struct PipelineEvent
+{
+	uint64_t start;
+	uint32_t duration;
+	uint32_t pc, instruction;
+	uint8_t stage;
+	bool bubble;
+	bool known; // the instruction word was seen, not only the pc
+};
+
+//****************************************************************
+// Stage occupant - what a stage holds, with a sequence number   *
+// telling apart two trips of the same pc, and the cycle it came *
+//****************************************************************
+struct StageOccupant
+{
+	uint64_t sequence; // 0 for an empty stage, before the first cycle recorded
+	uint64_t since;
+	uint32_t pc, instruction;
+	bool bubble;
+	bool known; // the instruction word was seen, not only the pc
+};
+
+//********************************************************************
+// Event recorder - follows every instruction through the stages and *
+// keeps the spans it spent in each in a ring buffer allocated up    *
+// front, so recording a cycle never allocates and a long run keeps  *
+// its last capacity events; written out as Chrome trace event JSON, *
+// one cycle to the microsecond, for a trace viewer such as Perfetto *
+// - only IF, ID and EX are read off the latches: EX/MEM and MEM/WB  *
+//   always take what the stage before them held, and a memory wait  *
+//   moves nothing, so it just goes unrecorded and stretches the     *
+//   spans it falls in                                               *
+//********************************************************************
+class EventRecorder
+{
+private:
+	std::vector<PipelineEvent> events;
+	size_t head; // where the next event goes, the oldest once the ring has wrapped
+	uint64_t recorded;
+	StageOccupant stages[STAGES];
+	uint64_t sequence;
+	bool held; // decode held its instruction last cycle
+
+	StageOccupant Fresh(uint32_t, uint32_t, bool, bool);
+	StageOccupant Follow(const StageOccupant &, uint32_t, uint32_t, bool);
+	void Close(PipelineStage, uint64_t);
+public:
+	explicit EventRecorder(size_t);
+
+	void Record(uint64_t, bool, uint32_t, uint32_t, const IFID &, const IDEX &, bool);
+	void Finish(uint64_t);
+	void Write(std::ostream &) const;
+
+	uint64_t GetDropped() const { return recorded - (recorded < events.size() ? recorded : events.size()); }
+};
+
+EventRecorder::EventRecorder(size_t capacity) : events(capacity == 0x0 ? 0x1 : capacity), head(0x0), recorded(0x0), stages{}, sequence(0x0),
+	held(false)
+{
+}
+
+// a new instruction or bubble entering the pipeline
+StageOccupant EventRecorder::Fresh(uint32_t pc, uint32_t instruction, bool bubble, bool known)
+{
+	return StageOccupant{ ++sequence, 0x0, pc, instruction, bubble, known };
+}
+
+//****************************************************************
+// Follow - the instruction moving in from the stage before, when *
+// it is the one the latch holds; one that turns up without being *
+// seen before, as at the start of a restored run, is fresh, and  *
+// unknown if the latch does not carry its instruction word       *
+//****************************************************************
+StageOccupant EventRecorder::Follow(const StageOccupant & before, uint32_t pc, uint32_t instruction, bool known)
+{
+	if (before.sequence != 0x0 && !before.bubble && before.pc == pc) { return before; }
+
+	return Fresh(pc, instruction, false, known);
+}
+
+// Close - end the span of whatever holds a stage, overwriting the oldest event once the ring is full
+void EventRecorder::Close(PipelineStage stage, uint64_t cycle)
+{
+	const StageOccupant & occupant{ stages[stage] };
+
+	if (occupant.sequence == 0x0) { return; }
+
+	events[head] = PipelineEvent{ occupant.since, static_cast<uint32_t>(cycle - occupant.since), occupant.pc, occupant.instruction, stage,
+		occupant.bubble, occupant.known };
+	if (++head == events.size()) { head = 0x0; }
+	++recorded;
+}
+
+//****************************************************************
+// Record - take one cycle: what fetch read from fetchPc, if it   *
+// read anything, the IF/ID and ID/EX latches decode and execute  *
+// worked on, and whether decode held its instruction; a stage    *
+// whose occupant changed closes the old span and opens a new one *
+//****************************************************************
+void EventRecorder::Record(uint64_t cycle, bool fetching, uint32_t fetchPc, uint32_t fetched, const IFID & decoding, const IDEX & executing,
+	bool stalled)
+{
+	StageOccupant next[STAGES];
+
+	next[STAGE_WB] = stages[STAGE_MEM];
+	next[STAGE_MEM] = stages[STAGE_EX];
+	next[STAGE_EX] = executing.IsBubble() ? Fresh(0x0, 0x0, true, false) : Follow(stages[STAGE_ID], executing.GetPc(), 0x0, false);
+	next[STAGE_ID] = !decoding.IsValid() ? Fresh(0x0, 0x0, true, false) :
+		Follow(stages[held ? STAGE_ID : STAGE_IF], decoding.GetPc(), decoding.GetInstruction(), true);
+	next[STAGE_IF] = fetching ? Fresh(fetchPc, fetched, false, true) : Fresh(0x0, 0x0, true, false);
+
+	for (uint8_t stage{ STAGE_IF }; stage < STAGES; ++stage)
+	{
+		if (next[stage].sequence == stages[stage].sequence) { continue; }
+
+		Close(static_cast<PipelineStage>(stage), cycle);
+		stages[stage] = next[stage];
+		stages[stage].since = cycle;
+	}
+
+	held = stalled;
+}
+
+// Finish - close every open span at the cycle the run stopped at
+void EventRecorder::Finish(uint64_t cycle)
+{
+	for (uint8_t stage{ STAGE_IF }; stage < STAGES; ++stage)
+	{
+		Close(static_cast<PipelineStage>(stage), cycle);
+		stages[stage] = StageOccupant{};
+	}
+}
+
+//*******************************************************************
+// Write - the recorded spans, oldest first, as a Chrome trace       *
+// event file: one complete ("X") event per span named after the     *
+// instruction word, on a track per stage; bubbles are named so, and *
+// spans whose word was never seen are named unknown                 *
+//*******************************************************************
+void EventRecorder::Write(std::ostream & out) const
+{
+	static const char * const STAGE_NAMES[STAGES]{ "IF", "ID", "EX", "MEM", "WB" };
+	OutputBuffer buffer(out);
+	size_t count{ recorded < events.size() ? static_cast<size_t>(recorded) : events.size() };
+	size_t first{ recorded < events.size() ? 0x0 : head };
+
+	buffer.Reserve(0x400);
+	buffer.Put("{\"displayTimeUnit\": \"ns\", \"otherData\": {\"dropped_events\": ");
+	buffer.PutDec(GetDropped(), 0);
+	buffer.Put("}, \"traceEvents\": [\n{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 0, \"args\": {\"name\": \"pipeline\"}}");
+
+	for (uint8_t stage{ STAGE_IF }; stage < STAGES; ++stage)
+	{
+		buffer.Put(",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": ");
+		buffer.PutDec(stage, 0);
+		buffer.Put(", \"args\": {\"name\": \"");
+		buffer.Put(STAGE_NAMES[stage], strlen(STAGE_NAMES[stage]));
+		buffer.Put("\"}},\n{\"name\": \"thread_sort_index\", \"ph\": \"M\", \"pid\": 0, \"tid\": ");
+		buffer.PutDec(stage, 0);
+		buffer.Put(", \"args\": {\"sort_index\": ");
+		buffer.PutDec(stage, 0);
+		buffer.Put("}}");
+	}
+
+	for (size_t i{ 0x0 }; i < count; ++i)
+	{
+		const PipelineEvent & event{ events[(first + i) % events.size()] };
+
+		buffer.Reserve(0x100);
+		if (event.bubble) { buffer.Put(",\n{\"name\": \"bubble\", \"cat\": \"bubble\""); }
+		else if (!event.known) { buffer.Put(",\n{\"name\": \"unknown\", \"cat\": \"instruction\""); }
+		else
+		{
+			buffer.Put(",\n{\"name\": \"0x");
+			buffer.PutHex(event.instruction, 8);
+			buffer.Put("\", \"cat\": \"instruction\"");
+		}
+
+		buffer.Put(", \"ph\": \"X\", \"pid\": 0, \"tid\": ");
+		buffer.PutDec(event.stage, 0);
+		buffer.Put(", \"ts\": ");
+		buffer.PutDec(event.start, 0);
+		buffer.Put(", \"dur\": ");
+		buffer.PutDec(event.duration, 0);
+		if (!event.bubble)
+		{
+			buffer.Put(", \"args\": {\"pc\": \"0x");
+			buffer.PutHex(event.pc, 8);
+			buffer.Put("\"}");
+		}
+		buffer.Put('}');
+	}
+
+	buffer.Reserve(0x10);
+	buffer.Put("\n]}\n");
+}
+
+#endif
@@ -2,55 +2,69 @@
 #define IDEX_H
 
 #include <cstdint>
+#include "Control.h"
 
 //*************************************************************************************
 // ID/EX pipeline register for control lines, parsed instruction, and register values *
+// - the control lines are packed into one control word (see Control.h)              *
+// - starts out as a bubble, until the first instruction is decoded                  *
+// - branches carry their target address in the offset field                          *
 //*************************************************************************************
 class IDEX
 {
 	private:
-		bool aluSrc, memRead, memToReg, memWrite, regDest, regWrite; // control lines
-		uint32_t aluOp, seOffset, function, writeReg15_11, writeReg20_16; // parsed instruction parts
+		uint32_t control; // control lines
+		uint32_t seOffset; // parsed instruction parts
+		uint32_t pc; // address of the instruction, for the fall through of a branch
 		int32_t readReg1Value, readReg2Value; // register values
+		uint8_t function, readReg1, writeReg15_11, writeReg20_16; // parsed instruction parts
+		AluOperation aluControl; // ALU operation for the execute stage
 	public:
 		IDEX(); // constructor - initializes values 
 
 		// mutators
-		void SetAluSrc(bool val) { aluSrc = val; }
-		void SetMemRead(bool val) { memRead = val; }
-		void SetMemToReg(bool val) { memToReg = val; }
-		void SetMemWrite(bool val) { memWrite = val; }
-		void SetRegDest(bool val) { regDest = val; }
-		void SetRegWrite(bool val) { regWrite = val; }
-		void SetAluOp(uint32_t val) { aluOp = val; }
+		void SetControl(uint32_t val) { control = val; }
 		void SetSignExtendedOffset(uint32_t val) { seOffset = val; }
-		void SetFunction(uint32_t val) { function = val; }
-		void SetWriteReg15_11(uint32_t val) { writeReg15_11 = val; }
-		void SetWriteReg20_16(uint32_t val) { writeReg20_16 = val; }
+		void SetPc(uint32_t val) { pc = val; }
+		void SetFunction(uint32_t val) { function = static_cast<uint8_t>(val); }
+		void SetReadReg1(uint32_t val) { readReg1 = static_cast<uint8_t>(val); }
+		void SetWriteReg15_11(uint32_t val) { writeReg15_11 = static_cast<uint8_t>(val); }
+		void SetWriteReg20_16(uint32_t val) { writeReg20_16 = static_cast<uint8_t>(val); }
 		void SetReadReg1Value(int32_t val) { readReg1Value = val; }
 		void SetReadReg2Value(int32_t val) { readReg2Value = val; }
+		void SetAluControl(AluOperation val) { aluControl = val; }
 
 		// accessors
-		bool GetAluSrc() const { return aluSrc; }
-		bool GetMemRead() const { return memRead; }
-		bool GetMemToReg() const { return memToReg; }
-		bool GetMemWrite() const { return memWrite; }
-		bool GetRegDest() const { return regDest; }
-		bool GetRegWrite() const { return regWrite; }
-		uint32_t GetAluOp() const { return aluOp; }
+		uint32_t GetControl() const { return control; }
+		bool GetAluSrc() const { return (control & CTRL_ALU_SRC) != 0x0; }
+		bool GetMemRead() const { return (control & CTRL_MEM_READ) != 0x0; }
+		bool GetMemToReg() const { return (control & CTRL_MEM_TO_REG) != 0x0; }
+		bool GetMemWrite() const { return (control & CTRL_MEM_WRITE) != 0x0; }
+		bool GetRegDest() const { return (control & CTRL_REG_DEST) != 0x0; }
+		bool GetRegWrite() const { return (control & CTRL_REG_WRITE) != 0x0; }
+		bool IsBubble() const { return (control & CTRL_BUBBLE) != 0x0; }
+		bool IsPredictedTaken() const { return (control & CTRL_PREDICTED_TAKEN) != 0x0; }
+		uint32_t GetAluOp() const { return (control & CTRL_ALU_OP_BM) >> CTRL_ALU_OP_SHIFT; }
 		uint32_t GetSignExtendedOffset() const { return seOffset; }
+		uint32_t GetPc() const { return pc; }
 		uint32_t GetFunction() const { return function; }
+		uint32_t GetReadReg1() const { return readReg1; }
+		uint32_t GetReadReg2() const { return writeReg20_16; } // rt is both a source and the load destination
+		bool UsesReadReg2() const { return !GetAluSrc() || GetMemWrite(); } // r-format operand or store data
 		uint32_t GetWriteReg15_11() const { return writeReg15_11; }
 		uint32_t GetWriteReg20_16() const { return writeReg20_16; }
 		int32_t GetReadReg1Value() const { return readReg1Value; }
 		int32_t GetReadReg2Value() const { return readReg2Value; }
+		AluOperation GetAluControl() const { return aluControl; }
 };
 
 IDEX::IDEX() // constructor - initializes values
 {
-	aluSrc = memRead = memToReg = memWrite = regDest = regWrite = 0x0;
-	aluOp = seOffset = function = writeReg15_11 = writeReg20_16 = 0x0;
+	control = BUBBLE_CONTROL;
+	seOffset = pc = 0x0;
 	readReg1Value = readReg2Value = 0x0;
+	function = readReg1 = writeReg15_11 = writeReg20_16 = 0x0;
+	aluControl = ALU_ADD;
 }
 
-#endif
\ No newline at end of file
+#endif
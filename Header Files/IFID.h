@@ -3,17 +3,23 @@
 
 #include <cstdint>
 
-//**************************************************
-// IF/ID pipeline register for caching instruction *
-//**************************************************
+//*****************************************************************
+// IF/ID pipeline register for caching instruction and its address *
+//*****************************************************************
 class IFID
 {
 	private:
 		uint32_t instruction;
+		uint32_t pc; // address the instruction was fetched from
+		bool valid; // an instruction has been fetched into the register
+		bool predictedTaken; // fetch went on at the predicted target rather than pc + 4
 	public:
-		IFID() { instruction = 0x0; }
-		void SetInstruction(uint32_t val) { instruction = val; }
+		IFID() { instruction = pc = 0x0; valid = predictedTaken = false; }
+		void SetInstruction(uint32_t val, uint32_t address, bool taken) { instruction = val; pc = address; valid = true; predictedTaken = taken; }
 		uint32_t GetInstruction() const { return instruction; }
+		uint32_t GetPc() const { return pc; }
+		bool IsValid() const { return valid; }
+		bool IsPredictedTaken() const { return predictedTaken; }
 };
 
-#endif
\ No newline at end of file
+#endif
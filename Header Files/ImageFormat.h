@@ -0,0 +1,37 @@
+#ifndef IMAGEFORMAT_H
+#define IMAGEFORMAT_H
+
+#include <cstdint>
+
+//*****************************************************************************
+// Binary instruction image - a 32 byte header followed by textWords          *
+// instructions and dataWords main memory words, all little-endian uint32_t   *
+// in the file; data word i fills the 4 main memory bytes at dataBase + 4 * i *
+// in the simulated machine's (big-endian) byte order, so lw reads it back    *
+//*****************************************************************************
+struct ImageHeader
+{
+	char magic[4]; // IMAGE_MAGIC
+	uint32_t version; // IMAGE_VERSION
+	uint32_t textWords; // instruction words following the header
+	uint32_t dataWords; // data words following the instructions
+	uint32_t dataBase; // first main memory byte seeded by the data section, four bytes per data word
+	uint32_t reserved[3]; // pads the header so the words stay aligned
+};
+
+const char IMAGE_MAGIC[4]{ 'M', 'P', 'S', 'I' };
+const uint32_t IMAGE_VERSION{ 0x2 };
+
+static_assert(sizeof(ImageHeader) == 32, "image header layout must not change");
+
+// image words are stored little-endian - only big-endian hosts pay for a swap
+inline uint32_t ImageWord(uint32_t word)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	return __builtin_bswap32(word);
+#else
+	return word;
+#endif
+}
+
+#endif
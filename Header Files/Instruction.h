@@ -0,0 +1,31 @@
+#ifndef INSTRUCTION_H
+#define INSTRUCTION_H
+
+#include <cstdint>
+
+// bitmasks
+const uint32_t
+	OPCODE_BM{ 0xFC000000 },
+	READ_REG1_BM{ 0x03E00000 },
+	READ_REG2_BM{ 0x001F0000 },
+	WRITE_REG_15_11_BM{ 0x0000F800 },
+	WRITE_REG_20_16_BM{ 0x001F0000 },
+	FUNCTION_BM{ 0x0000003F },
+	OFFSET_BM{ 0x0000FFFF },
+	SIGN_BM{ 0x00008000 },
+	SHAMT_BM{ 0x000007C0 },
+	JUMP_INDEX_BM{ 0x03FFFFFF };
+
+// bitwise shifts
+const uint32_t
+	OPCODE_SHIFT{ 26 },
+	READ_REG1_SHIFT{ 21 },
+	READ_REG2_SHIFT{ 16 },
+	WRITE_REG_15_11_SHIFT{ 11 },
+	WRITE_REG_20_16_SHIFT{ 16 },
+	SHAMT_SHIFT{ 6 };
+
+const uint32_t JR_FUNCTION{ 0x08 }; // jump register
+const uint32_t JALR_FUNCTION{ 0x09 }; // jump and link register - not implemented, only recognized as a branch by the ELF loader
+
+#endif
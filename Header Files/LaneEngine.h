@@ -0,0 +1,259 @@
+#ifndef LANEENGINE_H
+#define LANEENGINE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Control.h"
+#include "Instruction.h"
+#include "Predecode.h"
+#include "SparseMemory.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+const uint32_t LANE_BLOCK{ 0x8 }; // lanes are padded to whole 256 bit vectors of int32_t
+
+//******************************************************************
+// Lane vectors - the widest integer vector the build targets,     *
+// with the few operations the lane engine needs; every width      *
+// divides LANE_BLOCK, so register rows never need a scalar tail   *
+//******************************************************************
+#if defined(__AVX2__)
+typedef __m256i LaneVector;
+const uint32_t LANE_VECTOR{ 0x8 };
+
+inline LaneVector VectorLoad(const int32_t * row) { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row)); }
+inline void VectorStore(int32_t * row, LaneVector val) { _mm256_storeu_si256(reinterpret_cast<__m256i *>(row), val); }
+
+inline LaneVector VectorAlu(AluOperation operation, LaneVector a, LaneVector b, int32_t shamt)
+{
+	switch (operation)
+	{
+	case ALU_ADD: return _mm256_add_epi32(a, b);
+	case ALU_SUB: return _mm256_sub_epi32(a, b);
+	case ALU_AND: return _mm256_and_si256(a, b);
+	case ALU_OR: return _mm256_or_si256(a, b);
+	case ALU_SLT: return _mm256_srli_epi32(_mm256_cmpgt_epi32(b, a), 31);
+	case ALU_SLL: return _mm256_sll_epi32(a, _mm_cvtsi32_si128(shamt));
+	case ALU_SRL: return _mm256_srl_epi32(a, _mm_cvtsi32_si128(shamt));
+	case ALU_LUI: return _mm256_slli_epi32(b, 16);
+	default: return _mm256_setzero_si256();
+	}
+}
+
+// mask ? a : b, lane by lane
+inline LaneVector VectorSelect(LaneVector mask, LaneVector a, LaneVector b)
+{
+	return _mm256_or_si256(_mm256_and_si256(mask, a), _mm256_andnot_si256(mask, b));
+}
+#elif defined(__SSE2__) || defined(_M_X64)
+typedef __m128i LaneVector;
+const uint32_t LANE_VECTOR{ 0x4 };
+
+inline LaneVector VectorLoad(const int32_t * row) { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(row)); }
+inline void VectorStore(int32_t * row, LaneVector val) { _mm_storeu_si128(reinterpret_cast<__m128i *>(row), val); }
+
+inline LaneVector VectorAlu(AluOperation operation, LaneVector a, LaneVector b, int32_t shamt)
+{
+	switch (operation)
+	{
+	case ALU_ADD: return _mm_add_epi32(a, b);
+	case ALU_SUB: return _mm_sub_epi32(a, b);
+	case ALU_AND: return _mm_and_si128(a, b);
+	case ALU_OR: return _mm_or_si128(a, b);
+	case ALU_SLT: return _mm_srli_epi32(_mm_cmpgt_epi32(b, a), 31);
+	case ALU_SLL: return _mm_sll_epi32(a, _mm_cvtsi32_si128(shamt));
+	case ALU_SRL: return _mm_srl_epi32(a, _mm_cvtsi32_si128(shamt));
+	case ALU_LUI: return _mm_slli_epi32(b, 16);
+	default: return _mm_setzero_si128();
+	}
+}
+
+// mask ? a : b, lane by lane
+inline LaneVector VectorSelect(LaneVector mask, LaneVector a, LaneVector b)
+{
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+#else
+typedef int32_t LaneVector;
+const uint32_t LANE_VECTOR{ 0x1 };
+
+inline LaneVector VectorLoad(const int32_t * row) { return *row; }
+inline void VectorStore(int32_t * row, LaneVector val) { *row = val; }
+inline LaneVector VectorAlu(AluOperation operation, LaneVector a, LaneVector b, int32_t shamt) { return Alu(operation, a, IsShift(operation) ? shamt : b); }
+inline LaneVector VectorSelect(LaneVector mask, LaneVector a, LaneVector b) { return (mask & a) | (~mask & b); }
+#endif
+
+static_assert(LANE_BLOCK % LANE_VECTOR == 0x0, "register rows must hold whole vectors");
+
+//*********************************************************************
+// Lane engine - runs one trace over many independent machines at    *
+// once: the register files are kept structure-of-arrays, register r *
+// of every lane side by side, so the ALU work of each instruction   *
+// is a few vector ops across all lanes; loads and stores still go   *
+// lane by lane, each lane having its own main memory                *
+// - lane 0 leads: jumps and branches follow its registers, and a    *
+//   lane that would have gone another way drops out, keeping the    *
+//   state it had when it diverged                                   *
+//*********************************************************************
+class LaneEngine
+{
+private:
+	uint32_t lanes, stride; // lanes in use, and lanes per register row including padding
+	std::vector<int32_t> regs; // 0x20 rows of stride lanes
+	std::vector<int32_t> active; // one row: all ones for lanes still following lane 0, 0 for the rest
+	std::vector<int32_t> scratch; // one row for immediates and load/store addresses
+	std::vector<std::unique_ptr<SparseMemory>> memories;
+	PredecodeCache predecode;
+	uint32_t pc;
+	uint64_t executed;
+	uint64_t unsupported; // executed encodings the simulator does not implement, run as no-ops
+
+	int32_t * Row(uint32_t reg) { return &regs[static_cast<size_t>(reg) * stride]; }
+	void AluRow(AluOperation, int32_t *, const int32_t *, const int32_t *, int32_t);
+public:
+	explicit LaneEngine(uint32_t);
+
+	void Execute(uint32_t);
+
+	uint32_t GetLanes() const { return lanes; }
+	uint32_t GetPc() const { return pc; }
+	void SetPc(uint32_t val) { pc = val; } // only before the first instruction, when every lane is still together
+	uint64_t GetExecuted() const { return executed; }
+	uint64_t GetUnsupported() const { return unsupported; }
+	bool IsActive(uint32_t lane) const { return active[lane] != 0x0; }
+	int32_t GetRegister(uint32_t lane, uint32_t reg) const { return regs[static_cast<size_t>(reg) * stride + lane]; }
+	void SetRegister(uint32_t lane, uint32_t reg, int32_t val) { if (reg != 0x0) { regs[static_cast<size_t>(reg) * stride + lane] = val; } }
+	SparseMemory & GetMemory(uint32_t lane) { return *memories[lane]; }
+};
+
+//****************************************************************
+// Constructor - every lane starts with the processor's register *
+// pattern; main memory is left for the caller to seed           *
+//****************************************************************
+LaneEngine::LaneEngine(uint32_t laneCount) : lanes(laneCount), pc(0x0), executed(0x0), unsupported(0x0)
+{
+	stride = (lanes + LANE_BLOCK - 0x1) / LANE_BLOCK * LANE_BLOCK;
+	regs.assign(static_cast<size_t>(0x20) * stride, 0x0);
+	scratch.assign(stride, 0x0);
+	active.assign(stride, 0x0);
+
+	for (uint32_t reg{ 0x1 }; reg < 0x20; ++reg)
+	{
+		for (uint32_t lane{ 0x0 }; lane < stride; ++lane) { Row(reg)[lane] = 0x100 + reg; }
+	}
+
+	for (uint32_t lane{ 0x0 }; lane < lanes; ++lane)
+	{
+		active[lane] = -0x1;
+		memories.emplace_back(new SparseMemory);
+	}
+}
+
+//**************************************************************
+// AluRow - dest = a op b for every lane still following, with *
+// the same wrap-around as Alu; lanes that dropped out keep    *
+// their old value                                             *
+//**************************************************************
+void LaneEngine::AluRow(AluOperation operation, int32_t * dest, const int32_t * a, const int32_t * b, int32_t shamt)
+{
+	for (size_t i{ 0x0 }; i < stride; i += LANE_VECTOR)
+	{
+		LaneVector result{ VectorAlu(operation, VectorLoad(a + i), VectorLoad(b + i), shamt) };
+		VectorStore(dest + i, VectorSelect(VectorLoad(&active[i]), result, VectorLoad(dest + i)));
+	}
+}
+
+//***************************************************************
+// Execute - run the instruction at pc on every lane still     *
+// following and move pc on, with the same semantics as        *
+// Processor::ExecuteFunctional                                *
+//***************************************************************
+void LaneEngine::Execute(uint32_t instruction)
+{
+	const DecodedInstruction & decoded{ predecode.Lookup(instruction) };
+	uint32_t dest{ (decoded.control & CTRL_REG_DEST) != 0x0 ? decoded.writeReg15_11 : decoded.writeReg20_16 };
+	uint32_t nextPc{ pc + 0x4 };
+	const int32_t * rs{ Row(decoded.readReg1) };
+	const int32_t * rt{ Row(decoded.readReg2) };
+
+	++executed;
+	if ((decoded.control & CTRL_UNSUPPORTED) != 0x0) { ++unsupported; }
+	pc = nextPc;
+
+	if ((decoded.control & CTRL_JUMP) != 0x0) // the same for every lane
+	{
+		if ((decoded.control & CTRL_LINK) != 0x0)
+		{
+			scratch.assign(stride, static_cast<int32_t>(nextPc));
+			AluRow(ALU_OR, Row(LINK_REG), scratch.data(), scratch.data(), 0x0); // x | x copies the return address in
+		}
+
+		pc = JumpTarget(nextPc, decoded.seOffset);
+		return;
+	}
+
+	// lane 0 picks the way, the lanes that would go the other way drop out
+	if ((decoded.control & CTRL_BRANCH) != 0x0)
+	{
+		bool equal{ rs[0] == rt[0] };
+
+		for (uint32_t lane{ 0x1 }; lane < lanes; ++lane)
+		{
+			if ((rs[lane] == rt[lane]) != equal) { active[lane] = 0x0; }
+		}
+
+		if (equal != ((decoded.control & CTRL_BRANCH_NE) != 0x0)) { pc = BranchTarget(nextPc, decoded.seOffset); }
+		return;
+	}
+
+	if ((decoded.control & CTRL_JUMP_REG) != 0x0)
+	{
+		pc = static_cast<uint32_t>(rs[0]) & ~0x3;
+
+		for (uint32_t lane{ 0x1 }; lane < lanes; ++lane)
+		{
+			if ((static_cast<uint32_t>(rs[lane]) & ~0x3) != pc) { active[lane] = 0x0; }
+		}
+
+		return;
+	}
+
+	// the second operand is the immediate or register 2, shifts move register 2 instead
+	const int32_t * a{ IsShift(decoded.aluControl) ? rt : rs };
+	const int32_t * b{ rt };
+	int32_t shamt{ static_cast<int32_t>((decoded.seOffset & SHAMT_BM) >> SHAMT_SHIFT) };
+
+	if ((decoded.control & CTRL_ALU_SRC) != 0x0)
+	{
+		scratch.assign(stride, static_cast<int32_t>(decoded.seOffset));
+		b = scratch.data();
+	}
+
+	if ((decoded.control & (CTRL_MEM_READ | CTRL_MEM_WRITE)) != 0x0) // address calculation
+	{
+		uint32_t size{ MemAccessSize(decoded.control) };
+
+		AluRow(ALU_ADD, scratch.data(), rs, scratch.data(), 0x0);
+
+		for (uint32_t lane{ 0x0 }; lane < lanes; ++lane)
+		{
+			if (active[lane] == 0x0) { continue; }
+
+			uint32_t address{ static_cast<uint32_t>(scratch[lane]) };
+
+			if ((decoded.control & CTRL_MEM_WRITE) != 0x0) { memories[lane]->Store(address, static_cast<uint32_t>(rt[lane]), size); }
+			else if (dest != 0x0) { Row(dest)[lane] = ExtendLoad(memories[lane]->Load(address, size), decoded.control); }
+		}
+	}
+	else if ((decoded.control & CTRL_REG_WRITE) != 0x0 && dest != 0x0) // r-format or immediate
+	{
+		AluRow(decoded.aluControl, Row(dest), a, b, shamt);
+	}
+}
+
+#endif
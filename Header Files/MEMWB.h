@@ -2,29 +2,40 @@
 #define MEMWB_H
 
 #include <cstdint>
+#include "Control.h"
+
+const uint32_t MEMWB_CONTROL_BM{ CTRL_MEM_TO_REG | CTRL_MEM_WRITE | CTRL_REG_WRITE | CTRL_BUBBLE | CTRL_TRANSFER_BM };
+
+static_assert(MEMWB_CONTROL_BM <= 0xFFFF, "MEM/WB control lines must fit in 16 bits");
 
 //***********************************************************************************************
 // MEM/WB pipeline register for control lines, ALU calculated values, and write register number *
+// - memToReg, memWrite, regWrite, bubble and the control transfer bits keep their control word *
+//   bits (see Control.h), in 16 bits as all of them are below 0x10000                         *
+// - memWrite, bubble and the transfer bits are only kept to classify the retiring instruction  *
 //***********************************************************************************************
 class MEMWB
 {
 private:
-	bool memToReg, regWrite; // control lines
-	int32_t loadByteValue, aluResult; // ALU calculated values
-	uint32_t writeRegNum; // write register number
+	int32_t loadByteValue, aluResult; // loaded (byte, halfword or word) and ALU calculated values
+	uint16_t control; // control lines
+	uint8_t writeRegNum; // write register number
 public:
 	MEMWB(); // constructor - initializes values
 
 	// mutators
-	void SetMemToReg(bool val) { memToReg = val; }
-	void SetRegWrite(bool val) { regWrite = val; }
+	void SetControl(uint32_t val) { control = static_cast<uint16_t>(val & MEMWB_CONTROL_BM); }
 	void SetLoadByteValue(int32_t val) { loadByteValue = val; }
 	void SetAluResult(int32_t val) { aluResult = val; }
-	void SetWriteRegNum(uint32_t val) { writeRegNum = val; }
+	void SetWriteRegNum(uint32_t val) { writeRegNum = static_cast<uint8_t>(val); }
 
 	// accessors
-	bool GetMemToReg() const { return memToReg; }
-	bool GetRegWrite() const { return regWrite; }
+	uint32_t GetControl() const { return control; }
+	bool GetMemToReg() const { return (control & CTRL_MEM_TO_REG) != 0x0; }
+	bool GetMemWrite() const { return (control & CTRL_MEM_WRITE) != 0x0; }
+	bool GetRegWrite() const { return (control & CTRL_REG_WRITE) != 0x0; }
+	bool IsBubble() const { return (control & CTRL_BUBBLE) != 0x0; }
+	bool IsControlTransfer() const { return (control & CTRL_TRANSFER_BM) != 0x0; }
 	int32_t GetLoadByteValue() const { return loadByteValue; }
 	int32_t GetAluResult() const { return aluResult; }
 	uint32_t GetWriteRegNum() const { return writeRegNum; }
@@ -32,9 +43,9 @@ public:
 
 MEMWB::MEMWB() // ctor - initializes values
 {
-	memToReg = regWrite = 0x0;
+	control = BUBBLE_CONTROL;
 	loadByteValue = aluResult = 0x0;
 	writeRegNum = 0x0;
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,109 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//****************************************************************
+// Read-only memory mapped file - the whole file is mapped once, *
+// and pages are only brought in by the OS as they are touched   *
+//****************************************************************
+class MappedFile
+{
+private:
+	const uint8_t * bytes;
+	size_t length;
+#ifdef _WIN32
+	HANDLE file, mapping;
+#endif
+public:
+	MappedFile(); // constructor - nothing mapped yet
+	~MappedFile() { Close(); }
+	MappedFile(const MappedFile &) = delete;
+	MappedFile & operator=(const MappedFile &) = delete;
+
+	bool Open(const std::string &);
+	void Close();
+
+	const uint8_t * GetData() const { return bytes; }
+	size_t GetSize() const { return length; }
+};
+
+MappedFile::MappedFile()
+{
+	bytes = nullptr;
+	length = 0x0;
+#ifdef _WIN32
+	file = INVALID_HANDLE_VALUE;
+	mapping = NULL;
+#endif
+}
+
+//*************************************************
+// Open - map the file, returns false on failure  *
+//*************************************************
+bool MappedFile::Open(const std::string & filename)
+{
+	Close();
+
+#ifdef _WIN32
+	file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) { return false; }
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size)) { Close(); return false; }
+	length = static_cast<size_t>(size.QuadPart);
+	if (length == 0x0) { return true; } // nothing to map, but still a valid file
+
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL) { Close(); return false; }
+
+	bytes = static_cast<const uint8_t *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (bytes == nullptr) { Close(); return false; }
+#else
+	int descriptor{ open(filename.c_str(), O_RDONLY) };
+	if (descriptor < 0) { return false; }
+
+	struct stat status;
+	if (fstat(descriptor, &status) != 0) { close(descriptor); return false; }
+	length = static_cast<size_t>(status.st_size);
+	if (length == 0x0) { close(descriptor); return true; } // nothing to map, but still a valid file
+
+	void * view{ mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0) };
+	close(descriptor); // the mapping keeps its own reference to the file
+	if (view == MAP_FAILED) { length = 0x0; return false; }
+
+	madvise(view, length, MADV_SEQUENTIAL); // traces are read front to back
+	bytes = static_cast<const uint8_t *>(view);
+#endif
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (bytes != nullptr) { UnmapViewOfFile(bytes); }
+	if (mapping != NULL) { CloseHandle(mapping); }
+	if (file != INVALID_HANDLE_VALUE) { CloseHandle(file); }
+	mapping = NULL;
+	file = INVALID_HANDLE_VALUE;
+#else
+	if (bytes != nullptr) { munmap(const_cast<uint8_t *>(bytes), length); }
+#endif
+
+	bytes = nullptr;
+	length = 0x0;
+}
+
+#endif
@@ -0,0 +1,145 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// how much of the pipeline state is dumped to the output file
+enum class OutputLevel { None, Final, Interval, Cycle };
+
+// text reproduces the classic dump, binary writes raw snapshot records
+enum class OutputFormat { Text, Binary };
+
+// how the performance counter summary is written at the end of the run
+enum class StatsFormat { Json, Csv };
+
+// instruction classes the synthetic benchmark workload is mixed from
+enum WorkloadClass : uint8_t { WORK_ADD, WORK_SUB, WORK_LB, WORK_SB, WORK_NOOP, WORK_CLASSES };
+
+const uint32_t MAX_DEPENDENCY_DISTANCE{ 0x10 };
+
+//*****************************************************************
+// Workload mix - how the synthetic instruction stream is built: *
+// relative weights per class and how far back each source reads *
+//*****************************************************************
+struct WorkloadMix
+{
+	uint32_t weights[WORK_CLASSES]{ 40, 20, 20, 10, 10 }; // add, sub, lb, sb, nop
+	uint32_t dependencyDistance{ 0x1 }; // sources read the destination this many instructions back, 0 for independent
+	uint64_t seed{ 0x1 };
+	uint64_t instructions{ 0x0 };
+};
+
+// data cache replacement and write policies
+enum class CacheReplacement { Lru, Random };
+enum class CacheWritePolicy { WriteBack, WriteThrough };
+
+//***************************************************************
+// Cache config - data cache geometry in bytes, and the cycles  *
+// the pipeline stalls for on a hit and on top of that a miss   *
+//***************************************************************
+struct CacheConfig
+{
+	uint32_t size{ 0x0 }; // 0 for no cache
+	uint32_t lineSize{ 0x10 };
+	uint32_t ways{ 0x1 };
+	CacheReplacement replacement{ CacheReplacement::Lru };
+	CacheWritePolicy writePolicy{ CacheWritePolicy::WriteBack };
+	uint32_t hitLatency{ 0x0 };
+	uint32_t missPenalty{ 0xA };
+};
+
+// branch direction predictors
+enum class PredictorKind { NotTaken, Bimodal, Gshare };
+
+//*****************************************************************
+// Predictor config - which predictor fetch consults, the 2 bit   *
+// counters it keeps and the branch target buffer entries; both   *
+// sizes are powers of two                                        *
+//*****************************************************************
+struct PredictorConfig
+{
+	PredictorKind kind{ PredictorKind::NotTaken };
+	uint32_t counters{ 0x400 }; // gshare keeps log2(counters) bits of global history
+	uint32_t btbEntries{ 0x100 };
+};
+
+//******************************************************************
+// Lane assignment - one change a lane's initial machine makes to *
+// the default one: a register value or a main memory byte        *
+//******************************************************************
+struct LaneAssignment
+{
+	bool memory; // target is a byte address rather than a register number
+	uint32_t target;
+	int32_t val;
+};
+
+typedef std::vector<LaneAssignment> LaneState;
+
+//*******************************************************************
+// Simulation options - filled in from the command line, or left in *
+// interactive mode when the simulator is started without arguments *
+//*******************************************************************
+struct SimulationOptions
+{
+	bool interactive{ true }; // prompt for the input/output files on stdin
+	std::string inputPath{ "" }; // instruction trace to simulate
+	std::string outputPath{ "" }; // pipeline dump destination
+	uint64_t cycleLimit{ 0x0 }; // stop after this many cycles, 0 for no limit
+	bool verbose{ false }; // print a run summary to stdout when done
+	bool forwarding{ true }; // resolve data hazards by forwarding, otherwise by stalling
+	uint32_t issueWidth{ 0x1 }; // instructions fetched, decoded, executed and written back per cycle
+	std::string restorePath{ "" }; // start from this checkpoint instead of cycle 0, empty for none
+	std::string savePath{ "" }; // checkpoint the machine here when the run stops, empty for none
+	uint64_t fastForward{ 0x0 }; // instructions to execute functionally before the detailed pipeline takes over
+	CacheConfig dcache; // data cache in front of main memory
+	PredictorConfig predictor; // branch predictor consulted at fetch
+	bool check{ false }; // retire every instruction on a reference model too, stopping at the first result that differs
+	bool compareFunctional{ false }; // run the trace functionally from the same start too, and compare the final registers and memory
+
+	// pipeline dump
+	OutputLevel outputLevel{ OutputLevel::Cycle };
+	uint64_t outputInterval{ 0x1 }; // cycles between dumps for OutputLevel::Interval
+	OutputFormat outputFormat{ OutputFormat::Text };
+
+	// pipeline event trace
+	std::string eventsPath{ "" }; // write stage occupancy here as Chrome trace events, empty for none
+	uint32_t eventCapacity{ 0x100000 }; // events kept, the most recent ones once a run records more
+
+	// performance counter summary
+	std::string statsPath{ "" }; // write the counters here when the run ends, empty for none
+	StatsFormat statsFormat{ StatsFormat::Json };
+	bool prettyPrint{ false }; // render a binary snapshot file at inputPath as text instead of simulating
+
+	// text trace to binary image conversion
+	bool convert{ false }; // convert inputPath into an image at outputPath instead of simulating
+	std::string dataPath{ "" }; // optional hex data words for the image's data section
+	uint32_t dataBase{ 0x0 }; // main memory byte address the data section is loaded at
+
+	// batch runs of many jobs from a manifest
+	bool batch{ false }; // run the jobs listed in batchPath instead of a single trace
+	std::string batchPath{ "" };
+	uint32_t threads{ 0x0 }; // pool workers, 0 for one per hardware thread
+	std::string reportPath{ "" }; // per job counter summaries, stdout when empty
+
+	// one trace over many initial machine states at once
+	std::string lanesPath{ "" }; // lane states to run the trace functionally over, empty for a normal run
+
+	// synthetic workload benchmark
+	bool benchmark{ false }; // time a synthetic workload instead of simulating a trace
+	WorkloadMix workload;
+};
+
+//********************************************************************
+// Batch job - one manifest line: the command line options it gave, *
+// and the line itself to label the job's summary in the report     *
+//********************************************************************
+struct BatchJob
+{
+	SimulationOptions options;
+	std::string label;
+};
+
+#endif
@@ -0,0 +1,326 @@
+#ifndef OUTPUTSINK_H
+#define OUTPUTSINK_H
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "Options.h"
+
+//*********************************************************************
+// Pipeline snapshot - plain copy of every latch and register, used  *
+// as the binary record format; index 0 is Write, index 1 is Read    *
+//*********************************************************************
+struct SnapshotIDEX
+{
+	uint32_t signExtendedOffset, function, writeReg15_11, writeReg20_16, aluOp;
+	int32_t readReg1Value, readReg2Value;
+	uint8_t aluSrc, memRead, memToReg, memWrite, regDest, regWrite, reserved[2];
+};
+
+struct SnapshotEXMEM
+{
+	int32_t aluResult, storeByteValue;
+	uint32_t writeRegNum;
+	uint8_t memRead, memToReg, memWrite, regWrite;
+};
+
+struct SnapshotMEMWB
+{
+	int32_t aluResult, loadByteValue;
+	uint32_t writeRegNum;
+	uint8_t memToReg, regWrite, reserved[2];
+};
+
+struct PipelineSnapshot
+{
+	uint64_t cycle;
+	uint32_t ifidInstruction[2];
+	SnapshotIDEX idex[2];
+	SnapshotEXMEM exmem[2];
+	SnapshotMEMWB memwb[2];
+	int32_t regs[0x20];
+};
+
+static_assert(sizeof(PipelineSnapshot) == 280, "snapshot record layout must not change");
+
+const char SNAPSHOT_MAGIC[4]{ 'M', 'P', 'S', 'S' };
+const uint32_t SNAPSHOT_VERSION{ 0x1 };
+
+//*************************************************************************
+// Output buffer - collects formatted text in a large block and hands it *
+// to the stream in one write, instead of formatting through manipulators *
+// and flushing on every line                                            *
+//*************************************************************************
+class OutputBuffer
+{
+private:
+	std::ostream & output;
+	size_t used;
+	char data[0x10000];
+public:
+	explicit OutputBuffer(std::ostream & out) : output(out), used(0x0) {}
+	~OutputBuffer() { Flush(); }
+	OutputBuffer(const OutputBuffer &) = delete;
+	OutputBuffer & operator=(const OutputBuffer &) = delete;
+
+	// make room for count more bytes, callers then Put without further checks
+	void Reserve(size_t count) { if (used + count > sizeof(data)) { Flush(); } }
+
+	void Put(char c) { data[used++] = c; }
+	void Put(const char * text, size_t count) { memcpy(data + used, text, count); used += count; }
+	template <size_t N> void Put(const char (&text)[N]) { Put(text, N - 1); }
+	void PutHex(uint32_t, unsigned);
+	void PutDec(uint64_t, unsigned);
+	void PutBytes(const void *, size_t);
+	void Flush();
+};
+
+//***********************************************************
+// PutHex - uppercase hex, zero padded to at least width   *
+//***********************************************************
+void OutputBuffer::PutHex(uint32_t value, unsigned width)
+{
+	char digits[8];
+	unsigned count{ 0x0 };
+
+	do
+	{
+		digits[count++] = "0123456789ABCDEF"[value & 0xF];
+		value >>= 4;
+	} while (value != 0x0);
+
+	while (width > count) { Put('0'); --width; }
+	while (count > 0x0) { Put(digits[--count]); }
+}
+
+//************************************************************
+// PutDec - decimal, space padded on the left to width       *
+//************************************************************
+void OutputBuffer::PutDec(uint64_t value, unsigned width)
+{
+	char digits[20];
+	unsigned count{ 0x0 };
+
+	do
+	{
+		digits[count++] = static_cast<char>('0' + value % 10);
+		value /= 10;
+	} while (value != 0x0);
+
+	while (width > count) { Put(' '); --width; }
+	while (count > 0x0) { Put(digits[--count]); }
+}
+
+void OutputBuffer::PutBytes(const void * bytes, size_t count)
+{
+	if (count > sizeof(data))
+	{
+		Flush();
+		output.write(static_cast<const char *>(bytes), count);
+		return;
+	}
+
+	Reserve(count);
+	Put(static_cast<const char *>(bytes), count);
+}
+
+void OutputBuffer::Flush()
+{
+	output.write(data, used);
+	used = 0x0;
+}
+
+//**************************************************************************
+// FormatSnapshot - render a snapshot in the classic per-cycle text layout *
+//**************************************************************************
+void FormatSnapshot(const PipelineSnapshot & snapshot, OutputBuffer & out)
+{
+	static const char * const IFID_TITLES[2]{ "IF/ID Write: \n\n", "IF/ID Read: \n\n" };
+	static const char * const IDEX_TITLES[2]{ "ID/EX Write: \n\n", "ID/EX Read: \n\n" };
+	static const char * const EXMEM_TITLES[2]{ "EX/MEM Write: \n\n", "EX/MEM Read: \n\n" };
+	static const char * const MEMWB_TITLES[2]{ "MEM/WB Write: \n\n", "MEM/WB Read: \n\n" };
+
+	out.Reserve(0x1000); // comfortably more than one snapshot renders to
+
+	for (unsigned i{ 0x0 }; i < 79; ++i) { out.Put('*'); }
+	out.Put("\n\n\n");
+
+	for (unsigned i{ 0x0 }; i < 2; ++i)
+	{
+		out.Put(IFID_TITLES[i], strlen(IFID_TITLES[i]));
+		out.Put("\t Instruction: 0x");
+		out.PutHex(snapshot.ifidInstruction[i], 8);
+		out.Put("\n\n\n");
+		if (i == 1) { out.Put('\n'); } // the read latch gets an extra blank line
+	}
+
+	for (unsigned i{ 0x0 }; i < 2; ++i)
+	{
+		const SnapshotIDEX & idex{ snapshot.idex[i] };
+
+		out.Put(IDEX_TITLES[i], strlen(IDEX_TITLES[i]));
+		out.Put("\t signExtendedOffset: 0x");
+		out.PutHex(idex.signExtendedOffset, 8);
+		out.Put("\n\t function: 0x");
+		out.PutHex(idex.function, 0);
+		out.Put("\n\t readReg1Value: 0x");
+		out.PutHex(static_cast<uint32_t>(idex.readReg1Value), 0);
+		out.Put("\t readReg2Value: 0x");
+		out.PutHex(static_cast<uint32_t>(idex.readReg2Value), 0);
+		out.Put("\n\t writeReg15_11: ");
+		out.PutDec(idex.writeReg15_11, 0);
+		out.Put("\t writeReg20_16: ");
+		out.PutDec(idex.writeReg20_16, 0);
+		out.Put("\n\n\t control: aluOp: ");
+		out.PutDec(idex.aluOp, 0);
+		out.Put(", aluSrc: ");
+		out.PutDec(idex.aluSrc, 0);
+		out.Put(", memRead: ");
+		out.PutDec(idex.memRead, 0);
+		out.Put(", memToReg: ");
+		out.PutDec(idex.memToReg, 0);
+		out.Put("\n\t\t  memWrite: ");
+		out.PutDec(idex.memWrite, 0);
+		out.Put(", regDst: ");
+		out.PutDec(idex.regDest, 0);
+		out.Put(", regWrite: ");
+		out.PutDec(idex.regWrite, 0);
+		out.Put("\n\n\n");
+	}
+
+	for (unsigned i{ 0x0 }; i < 2; ++i)
+	{
+		const SnapshotEXMEM & exmem{ snapshot.exmem[i] };
+
+		out.Put(EXMEM_TITLES[i], strlen(EXMEM_TITLES[i]));
+		out.Put("\t aluResult: ");
+		out.PutHex(static_cast<uint32_t>(exmem.aluResult), 0);
+		out.Put(", storeByteValue: ");
+		out.PutHex(static_cast<uint32_t>(exmem.storeByteValue), 0);
+		out.Put(", writeRegNum: ");
+		out.PutDec(exmem.writeRegNum, 0);
+		out.Put("\n\t control: memRead: ");
+		out.PutDec(exmem.memRead, 0);
+		out.Put(", memToReg: ");
+		out.PutDec(exmem.memToReg, 0);
+		out.Put(", memWrite: ");
+		out.PutDec(exmem.memWrite, 0);
+		out.Put(", regWrite: ");
+		out.PutDec(exmem.regWrite, 0);
+		out.Put("\n\n\n");
+	}
+
+	for (unsigned i{ 0x0 }; i < 2; ++i)
+	{
+		const SnapshotMEMWB & memwb{ snapshot.memwb[i] };
+
+		out.Put(MEMWB_TITLES[i], strlen(MEMWB_TITLES[i]));
+		out.Put("\t aluResult: ");
+		out.PutHex(static_cast<uint32_t>(memwb.aluResult), 0);
+		out.Put(", loadByteValue: ");
+		out.PutHex(static_cast<uint32_t>(memwb.loadByteValue), 0);
+		out.Put(", writeRegNum: ");
+		out.PutDec(memwb.writeRegNum, 0);
+		out.Put("\n\n\t control: memToReg: ");
+		out.PutDec(memwb.memToReg, 0);
+		out.Put(", regWrite: ");
+		out.PutDec(memwb.regWrite, 0);
+		out.Put("\n\n\n");
+	}
+
+	out.Put("Registers: \n\n");
+	for (unsigned i{ 0x0 }; i < 0x20; ++i)
+	{
+		if (i % 4 == 0) { out.Put('\n'); } // formatting
+
+		out.PutDec(i, 6);
+		out.Put(": 0x");
+		out.PutHex(static_cast<uint32_t>(snapshot.regs[i]), 0);
+
+		if (snapshot.regs[i] < 0x10) { out.Put("  "); } // formatting
+		else if (snapshot.regs[i] < 0x100) { out.Put(' '); }
+	}
+
+	out.Put("\n\n\n");
+}
+
+//*********************************************************************
+// Output sink - decides which cycles are dumped and writes them as  *
+// text or as binary snapshot records through a single large buffer  *
+//*********************************************************************
+class OutputSink
+{
+private:
+	OutputLevel level;
+	OutputFormat format;
+	uint64_t interval;
+	OutputBuffer buffer;
+public:
+	OutputSink(std::ostream &, const SimulationOptions &);
+
+	bool IsDue(uint64_t cycle) const { return level == OutputLevel::Cycle || (level == OutputLevel::Interval && cycle % interval == 0); }
+	bool WantsFinal() const { return level == OutputLevel::Final; }
+
+	void Write(const PipelineSnapshot &);
+	void Flush() { buffer.Flush(); }
+};
+
+OutputSink::OutputSink(std::ostream & out, const SimulationOptions & options) : buffer(out)
+{
+	level = options.outputLevel;
+	format = options.outputFormat;
+	interval = options.outputInterval == 0x0 ? 0x1 : options.outputInterval;
+
+	if (format == OutputFormat::Binary && level != OutputLevel::None)
+	{
+		uint32_t recordSize{ sizeof(PipelineSnapshot) };
+		buffer.PutBytes(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+		buffer.PutBytes(&SNAPSHOT_VERSION, sizeof(SNAPSHOT_VERSION));
+		buffer.PutBytes(&recordSize, sizeof(recordSize));
+	}
+}
+
+void OutputSink::Write(const PipelineSnapshot & snapshot)
+{
+	if (format == OutputFormat::Binary) { buffer.PutBytes(&snapshot, sizeof(snapshot)); }
+	else { FormatSnapshot(snapshot, buffer); }
+}
+
+//*********************************************************************
+// PrettyPrintSnapshots - offline rendering of a binary snapshot file *
+// into the text layout, returns false if the file is not readable    *
+//*********************************************************************
+bool PrettyPrintSnapshots(const std::string & inputPath, const std::string & outputPath)
+{
+	std::ifstream inputFile(inputPath, std::ios::binary);
+	std::ofstream outputFile(outputPath, std::ios::binary);
+	char magic[sizeof(SNAPSHOT_MAGIC)]{};
+	uint32_t version{ 0x0 }, recordSize{ 0x0 };
+
+	if (inputFile.fail() || outputFile.fail())
+	{
+		std::cerr << "Error: unable to open " << (inputFile.fail() ? inputPath : outputPath) << std::endl;
+		return false;
+	}
+
+	inputFile.read(magic, sizeof(magic));
+	inputFile.read(reinterpret_cast<char *>(&version), sizeof(version));
+	inputFile.read(reinterpret_cast<char *>(&recordSize), sizeof(recordSize));
+
+	if (!inputFile || memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) != 0 || version != SNAPSHOT_VERSION || recordSize != sizeof(PipelineSnapshot))
+	{
+		std::cerr << "Error: not a version " << SNAPSHOT_VERSION << " snapshot file: " << inputPath << std::endl;
+		return false;
+	}
+
+	OutputBuffer buffer(outputFile);
+	PipelineSnapshot snapshot;
+
+	while (inputFile.read(reinterpret_cast<char *>(&snapshot), sizeof(snapshot))) { FormatSnapshot(snapshot, buffer); }
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef PREDECODE_H
+#define PREDECODE_H
+
+#include <cstdint>
+#include "Control.h"
+#include "Instruction.h"
+
+//*******************************************************************
+// Decoded instruction - every field the decode stage extracts from *
+// an instruction word, so repeats of the word skip the bit fiddling *
+//*******************************************************************
+struct DecodedInstruction
+{
+	uint32_t instruction; // the word this entry was decoded from - doubles as the cache tag
+	uint32_t seOffset; // sign extended offset
+	uint32_t control; // packed control word from the control ROM
+	uint8_t readReg1, readReg2, writeReg15_11, writeReg20_16, function;
+	AluOperation aluControl; // ALU operation picked from aluOp and function
+	bool valid; // entry holds a decoded word
+};
+
+const uint32_t PREDECODE_BITS{ 10 }; // 1024 entries, small enough to stay in L1/L2
+
+//*********************************************************************
+// Predecode cache - direct mapped on the instruction word, filled on *
+// a miss by decoding the word once                                   *
+//*********************************************************************
+class PredecodeCache
+{
+private:
+	DecodedInstruction entries[0x1 << PREDECODE_BITS];
+	uint64_t lookups, hits;
+public:
+	PredecodeCache();
+
+	const DecodedInstruction & Lookup(uint32_t);
+	static void Decode(uint32_t, DecodedInstruction &);
+
+	uint64_t GetLookups() const { return lookups; }
+	uint64_t GetHits() const { return hits; }
+	double GetHitRate() const { return lookups == 0x0 ? 0.0 : static_cast<double>(hits) / lookups; }
+};
+
+PredecodeCache::PredecodeCache()
+{
+	for (DecodedInstruction & entry : entries) { entry.valid = false; }
+	lookups = hits = 0x0;
+}
+
+//**************************************************************
+// Lookup - return the decoded form of an instruction word,    *
+// decoding it into its slot first if it is not already there  *
+//**************************************************************
+const DecodedInstruction & PredecodeCache::Lookup(uint32_t instruction)
+{
+	// fibonacci hashing spreads the opcode/register bits over the index
+	DecodedInstruction & entry{ entries[(instruction * 0x9E3779B1) >> (32 - PREDECODE_BITS)] };
+
+	++lookups;
+	if (entry.valid && entry.instruction == instruction)
+	{
+		++hits;
+	}
+	else
+	{
+		Decode(instruction, entry);
+	}
+
+	return entry;
+}
+
+//***********************************************************
+// Decode - split the word into its fields and look up the *
+// control lines for the opcode                             *
+//***********************************************************
+void PredecodeCache::Decode(uint32_t instruction, DecodedInstruction & decoded)
+{
+	decoded.instruction = instruction;
+	decoded.valid = true;
+
+	decoded.readReg1 = static_cast<uint8_t>((instruction & READ_REG1_BM) >> READ_REG1_SHIFT);
+	decoded.readReg2 = static_cast<uint8_t>((instruction & READ_REG2_BM) >> READ_REG2_SHIFT);
+	decoded.writeReg15_11 = static_cast<uint8_t>((instruction & WRITE_REG_15_11_BM) >> WRITE_REG_15_11_SHIFT);
+	decoded.writeReg20_16 = static_cast<uint8_t>((instruction & WRITE_REG_20_16_BM) >> WRITE_REG_20_16_SHIFT);
+	decoded.function = static_cast<uint8_t>(instruction & FUNCTION_BM);
+
+	// calculate sign extended offset
+	decoded.seOffset = instruction & OFFSET_BM;
+	if (SIGN_BM & instruction) { decoded.seOffset += 0xFFFF0000; } // if bit 16 is a 1, extend with 0xFFFF
+
+	// control lines come straight from the ROM, word 0x0 is the no-op
+	uint32_t opcode{ (instruction & OPCODE_BM) >> OPCODE_SHIFT };
+	decoded.control = instruction == 0x0 ? NOOP_CONTROL : CONTROL_ROM.words[opcode];
+	if (opcode == 0x0 && decoded.function == JR_FUNCTION) { decoded.control = JR_CONTROL; }
+
+	if ((decoded.control & CTRL_ZERO_EXTEND) != 0x0) { decoded.seOffset = instruction & OFFSET_BM; }
+
+	// jumps read no registers - the offset field carries the target index instead, and jal links into $31
+	if ((decoded.control & CTRL_JUMP) != 0x0)
+	{
+		decoded.seOffset = (instruction & JUMP_INDEX_BM) << 2;
+		decoded.readReg1 = decoded.readReg2 = decoded.writeReg20_16 = 0x0;
+		decoded.writeReg15_11 = LINK_REG;
+	}
+
+	decoded.aluControl = AluControl((decoded.control & CTRL_ALU_OP_BM) >> CTRL_ALU_OP_SHIFT, decoded.function, opcode);
+
+	// r-format functions the ALU doesn't implement run as no-ops, flagged so the run can count them
+	if (decoded.aluControl == ALU_NONE)
+	{
+		decoded.control = UNSUPPORTED_CONTROL;
+		decoded.aluControl = ALU_ADD;
+	}
+}
+
+#endif
@@ -1,296 +1,834 @@
 #ifndef PROCESSOR_H
 #define PROCESSOR_H
 
-#include <fstream>
-#include <iomanip>
 #include "IFID.h"
 #include "IDEX.h"
 #include "EXMEM.h"
 #include "MEMWB.h"
+#include "Counters.h"
+#include "DataCache.h"
+#include "BranchPredictor.h"
+#include "OutputSink.h"
+#include "Predecode.h"
+#include "SparseMemory.h"
+#include "Checkpoint.h"
+
+const uint32_t MAX_ISSUE_WIDTH{ 0x4 };
+
+//****************************************************************
+// One slot of one side of the double-buffered pipeline         *
+// registers - packed so that each fills one cache line; a      *
+// bundle is width slots side by side, the oldest one in slot 0  *
+//****************************************************************
+struct alignas(64) PipelineLatches
+{
+	IFID ifid;
+	IDEX idex;
+	EXMEM exmem;
+	MEMWB memwb;
+};
+
+static_assert(sizeof(PipelineLatches) == 64, "pipeline latches should fill one cache line");
+
+//*******************************************************************
+// Pipeline config - the feature choices a Processor is compiled     *
+// for, so no stage tests them cycle by cycle and the paths a        *
+// variant leaves out are dropped at compile time                    *
+// - forwarding: data hazards forward, otherwise they stall          *
+// - cached: a data cache sits in front of main memory               *
+// - observed: the run dumps, records events or co-simulates as it   *
+//   goes, rather than only at the end                               *
+// - width: the issue width, 0 when it is only known at run time, as *
+//   for wide runs, restored checkpoints and observed runs           *
+//*******************************************************************
+template <bool Forwarding, bool Cached, bool Observed, uint32_t Width>
+struct PipelineConfig
+{
+	static constexpr bool FORWARDING{ Forwarding };
+	static constexpr bool DCACHE{ Cached };
+	static constexpr bool OBSERVED{ Observed };
+	static constexpr uint32_t WIDTH{ Width };
 
-// bitmasks
-const uint32_t
-	OPCODE_BM{ 0xFC000000 },
-	READ_REG1_BM{ 0x03E00000 },
-	READ_REG2_BM{ 0x001F0000 },
-	WRITE_REG_15_11_BM{ 0x0000F800 },
-	WRITE_REG_20_16_BM{ 0x001F0000 },
-	FUNCTION_BM{ 0x0000003F },
-	OFFSET_BM{ 0x0000FFFF },
-	SIGN_BM{ 0x00008000 };
-
-// bitwise shifts
-const uint32_t
-	OPCODE_SHIFT{ 26 },
-	READ_REG1_SHIFT{ 21 },
-	READ_REG2_SHIFT{ 16 },
-	WRITE_REG_15_11_SHIFT{ 11 },
-	WRITE_REG_20_16_SHIFT{ 16 };
+	static std::string Describe()
+	{
+		return std::string(FORWARDING ? "forwarding" : "stalling") + (DCACHE ? ", data cache" : ", no data cache") +
+			(OBSERVED ? ", observed" : ", unobserved") + (WIDTH == 0x0 ? ", issue width set at run time" : ", issue width " + std::to_string(WIDTH));
+	}
+};
 
+template <class Config>
 class Processor
 {
 private:
-	IFID IFID_Write, IFID_Read;
-	IDEX IDEX_Write, IDEX_Read;
-	EXMEM EXMEM_Write, EXMEM_Read;
-	MEMWB MEMWB_Write, MEMWB_Read;
+	PipelineLatches latches[2][MAX_ISSUE_WIDTH]; // write and read side bundles, selected by writeSide
+	uint32_t writeSide;
+	uint32_t width; // instructions each stage takes a cycle - 1, 2 or 4, when Config leaves it to run time
 	int32_t Regs[0x20];
+	uint32_t pc; // address of the next instruction to fetch
+	bool stalled; // the decode stage held some of its bundle this cycle
+	bool redirected; // pc left the straight line this cycle - a predicted target, a jump or a mispredicted branch
+	DataCache dcache;
+	BranchPredictor predictor;
+	uint32_t memoryWait; // cycles left before the pipeline moves again after a data cache miss
+	PerformanceCounters counters;
+
+	PipelineLatches * Write() { return latches[writeSide]; }
+	const PipelineLatches * Read() const { return latches[writeSide ^ 0x1]; }
+
+	// the issue width, a constant the stage loops unroll on unless Config leaves it to run time
+	uint32_t Width() const
+	{
+		if (Config::WIDTH != 0x0) { return Config::WIDTH; }
+		return width;
+	}
+
+	static bool ReadsRegister(const DecodedInstruction &, uint32_t);
+	bool IsHazard(const DecodedInstruction &) const;
+	void Hold(uint32_t);
+	int32_t ReadRegister(uint32_t) const;
+	int32_t Forward(uint32_t, int32_t);
+	bool ExecuteSlot(uint32_t);
+	void MemorySlot(uint32_t, SparseMemory &);
+	void WriteBackSlot(uint32_t);
+	void AccessCache(int32_t, bool);
+	void Redirect(uint32_t, bool);
+	bool IsValidState() const;
+	PredecodeCache predecode;
 public:
 	Processor();
-	void InstructionFetchStage(uint32_t);
+	void InstructionFetchStage(const uint32_t *, uint32_t);
 	void InstructionDecodeStage();
 	void ExecuteStage();
-	void MemoryStage(int32_t *);
+	void MemoryStage(SparseMemory &);
 	void WriteBackStage();
-	void Print(std::ofstream &) const;
+	void Print(OutputSink &, uint64_t) const;
 	void Copy();
+	void MemoryWaitCycle();
+	void ExecuteFunctional(uint32_t, SparseMemory &);
+	void SaveState(std::ostream &) const;
+	bool LoadState(std::istream &);
+
+	bool SetIssueWidth(uint32_t);
+	uint32_t GetIssueWidth() const { return Width(); }
+	bool ConfigureCache(const CacheConfig & config) { return dcache.Configure(config); }
+	bool ConfigurePredictor(const PredictorConfig & config) { return predictor.Configure(config); }
+	bool IsStalled() const { return stalled; }
+	bool IsRedirected() const { return redirected; }
+	bool IsDrained() const;
+	uint32_t GetPc() const { return pc; }
+	void SetPc(uint32_t val) { pc = val; } // only before the run starts, while the pipeline is empty
+	int32_t GetRegister(uint32_t reg) const { return Regs[reg]; }
+	void SetRegister(uint32_t reg, int32_t val) { if (reg != 0x0) { Regs[reg] = val; } }
+	bool IsWaitingOnMemory() const { return Config::DCACHE && memoryWait != 0x0; } // only a data cache ever waits
+	const IFID & GetDecodeInput() const { return Read()[0].ifid; } // what decode worked on this cycle, in the oldest slot
+	const IDEX & GetExecuteInput() const { return Read()[0].idex; } // what execute worked on this cycle, in the oldest slot
+	const EXMEM & GetMemoryInput(uint32_t slot) const { return Read()[slot].exmem; } // what the memory stage worked on this cycle
+	const MEMWB & GetWriteBackInput(uint32_t slot) const { return Read()[slot].memwb; } // what write back worked on this cycle
+	const PerformanceCounters & GetCounters() const { return counters; }
+	const PredecodeCache & GetPredecodeCache() const { return predecode; }
 };
 
 //***********************************************
 // Constructor - initialize processor registers *
 //***********************************************
-Processor::Processor()
+template <class Config>
+Processor<Config>::Processor()
 {
+	writeSide = 0x0;
+	width = 0x1;
+	pc = 0x0;
+	stalled = false;
+	redirected = false;
+	memoryWait = 0x0;
 	Regs[0x0] = 0x0;
 
 	for (size_t i{ 0x1 }; i < 0x20; ++i) { Regs[i] = 0x100 + i; }
 }
 
-//*************************************************
-// Instruction fetch stage - take the instruction *
-// and put it in the IF/ID pipeline register      *
-//*************************************************
+// SetIssueWidth - the bundle width, returns false unless 1, 2 or 4, or unless the one Config fixed
+template <class Config>
+bool Processor<Config>::SetIssueWidth(uint32_t val)
+{
+	if (Config::WIDTH != 0x0) { return val == Config::WIDTH; }
+	if (val != 0x1 && val != 0x2 && val != MAX_ISSUE_WIDTH) { return false; }
+
+	width = val;
+	return true;
+}
+
+//****************************************************************
+// Instruction fetch stage - take up to width instructions,      *
+// fetched from pc on, into the IF/ID slots and move pc past     *
+// each, to the target if the predictor says taken, which also   *
+// ends the bundle                                               *
+//****************************************************************
+
+template <class Config>
+void Processor<Config>::InstructionFetchStage(const uint32_t * instructions, uint32_t count)
+{
+	PipelineLatches * write{ Write() };
+	uint32_t slot{ 0x0 };
+
+	redirected = false;
+	for (; slot < Width() && slot < count && !redirected; ++slot)
+	{
+		uint32_t target{ 0x0 };
+		bool taken{ predictor.Predict(pc, target) };
+
+		write[slot].ifid.SetInstruction(instructions[slot], pc, taken);
+		pc = taken ? target : pc + 0x4;
+		redirected = taken;
+	}
+
+	for (; slot < Width(); ++slot) { write[slot].ifid = IFID(); }
+	++counters.cycles; // fetch runs exactly once a cycle
+}
+
+//*****************************************************************
+// Redirect - send fetch to where a jump or mispredicted branch   *
+// really goes and squash the younger bundles already in flight:  *
+// the one fetched this cycle, and when resolved in execute, the  *
+// one decoded this cycle too; the stage that redirects squashes  *
+// the slots behind it in its own bundle; there are no branch     *
+// delay slots, and jr targets are word aligned as there is no    *
+// address exception                                              *
+//*****************************************************************
+template <class Config>
+void Processor<Config>::Redirect(uint32_t target, bool fromExecute)
+{
+	PipelineLatches * write{ Write() };
+
+	pc = target & ~0x3;
+	redirected = true;
+
+	for (uint32_t slot{ 0x0 }; slot < Width(); ++slot)
+	{
+		if (write[slot].ifid.IsValid()) { ++counters.flushes; }
+		write[slot].ifid = IFID();
+
+		if (fromExecute)
+		{
+			if (!write[slot].idex.IsBubble()) { ++counters.flushes; }
+			write[slot].idex = IDEX();
+		}
+	}
+
+	if (fromExecute) { stalled = false; } // whatever decode held is on the wrong path
+}
+
+// ReadsRegister - true if the decoded instruction reads reg, $0 never counts
+template <class Config>
+bool Processor<Config>::ReadsRegister(const DecodedInstruction & decoded, uint32_t reg)
+{
+	bool usesReg2{ (decoded.control & CTRL_ALU_SRC) == 0x0 || (decoded.control & CTRL_MEM_WRITE) != 0x0 };
+
+	return reg != 0x0 && (reg == decoded.readReg1 || (usesReg2 && reg == decoded.readReg2));
+}
 
-void Processor::InstructionFetchStage(uint32_t instruction) { IFID_Write.SetInstruction(instruction); }
+//*****************************************************************
+// IsHazard - hazard detection: true if the decoded instruction   *
+// reads a register an instruction ahead of it has yet to produce *
+// in time - only a load in EX with forwarding, anything in EX or *
+// MEM without it (write back is bypassed by ReadRegister)        *
+//*****************************************************************
+template <class Config>
+bool Processor<Config>::IsHazard(const DecodedInstruction & decoded) const
+{
+	if (decoded.control == NOOP_CONTROL) { return false; }
+
+	for (uint32_t slot{ 0x0 }; slot < Width(); ++slot)
+	{
+		const IDEX & ex{ Read()[slot].idex };
+		const EXMEM & mem{ Read()[slot].exmem };
+		uint32_t exDest{ ex.GetRegDest() ? ex.GetWriteReg15_11() : ex.GetWriteReg20_16() };
+
+		if (Config::FORWARDING)
+		{
+			if (ex.GetMemRead() && ReadsRegister(decoded, exDest)) { return true; } // load-use
+		}
+		else if ((ex.GetRegWrite() && ReadsRegister(decoded, exDest)) || (mem.GetRegWrite() && ReadsRegister(decoded, mem.GetWriteRegNum())))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//******************************************************************
+// Hold - decode holds the instruction in slot and every one      *
+// behind it in the bundle: they go back to the front of IF/ID,   *
+// bubbles go down in their place, and what fetch read this cycle *
+// is fetched again after them                                    *
+//******************************************************************
+template <class Config>
+void Processor<Config>::Hold(uint32_t slot)
+{
+	PipelineLatches * write{ Write() };
+	const PipelineLatches * read{ Read() };
+
+	stalled = true;
+	if (write[0x0].ifid.IsValid()) { pc = write[0x0].ifid.GetPc(); } // fetch it again, wherever it was predicted to be; a drain fetches nothing
+
+	for (uint32_t i{ 0x0 }; i < Width(); ++i)
+	{
+		write[i].ifid = slot + i < Width() ? read[slot + i].ifid : IFID();
+
+		if (i < slot) { continue; }
+		if (read[i].ifid.IsValid()) { ++counters.bubbles; }
+		write[i].idex = IDEX();
+	}
+}
+
+//******************************************************************
+// ReadRegister - read the register file; a value being written   *
+// back this cycle is bypassed, as the register file writes first *
+// and the youngest write of a bundle wins                        *
+//******************************************************************
+template <class Config>
+int32_t Processor<Config>::ReadRegister(uint32_t reg) const
+{
+	for (uint32_t slot{ Width() }; reg != 0x0 && slot-- > 0x0;)
+	{
+		const MEMWB & wb{ Read()[slot].memwb };
+
+		if (wb.GetRegWrite() && wb.GetWriteRegNum() == reg) { return wb.GetMemToReg() ? wb.GetLoadByteValue() : wb.GetAluResult(); }
+	}
+
+	return Regs[reg];
+}
 
 //***********************************************************
-// Instruction decode stage - take the instruction from the *
-// IF/ID pipeline register, decode it and set control lines *
+// Instruction decode stage - take the bundle from the IF/ID *
+// pipeline registers, look up the predecoded fields of     *
+// each instruction and set the register values and control *
+// lines; an instruction with a hazard on an older bundle,  *
+// or reading what an older slot of its own bundle writes,  *
+// is held along with the slots behind it                   *
 //***********************************************************
-void Processor::InstructionDecodeStage()
+template <class Config>
+void Processor<Config>::InstructionDecodeStage()
 {
-	// fetch register information
-	IDEX_Write.SetReadReg1Value(Regs[(IFID_Read.GetInstruction() & READ_REG1_BM) >> READ_REG1_SHIFT]);
-	IDEX_Write.SetReadReg2Value(Regs[(IFID_Read.GetInstruction() & READ_REG2_BM) >> READ_REG2_SHIFT]);
-	IDEX_Write.SetWriteReg15_11((IFID_Read.GetInstruction() & WRITE_REG_15_11_BM) >> WRITE_REG_15_11_SHIFT);
-	IDEX_Write.SetWriteReg20_16((IFID_Read.GetInstruction() & WRITE_REG_20_16_BM) >> WRITE_REG_20_16_SHIFT);
-
-	// decode function
-	IDEX_Write.SetFunction(IFID_Read.GetInstruction() & FUNCTION_BM);
-
-	// calculate sign extended offset
-	uint32_t offset{ IFID_Read.GetInstruction() & OFFSET_BM };
-	if (SIGN_BM & IFID_Read.GetInstruction()) { offset += 0xFFFF0000; } // if bit 16 is a 1, extend with 0xFFFF
-	IDEX_Write.SetSignExtendedOffset(offset); // set the offset
-
-	// set control lines based on the opcode
-	if (IFID_Read.GetInstruction() == 0x0) // no-op
-	{
-		IDEX_Write.SetAluOp(0);
-		IDEX_Write.SetAluSrc(0);
-		IDEX_Write.SetMemRead(0);
-		IDEX_Write.SetMemToReg(0);
-		IDEX_Write.SetMemWrite(0);
-		IDEX_Write.SetRegDest(0);
-		IDEX_Write.SetRegWrite(0);
-	}
-	else if (((IFID_Read.GetInstruction() & OPCODE_BM) >> OPCODE_SHIFT) == 0x0) // r-format
-	{
-		IDEX_Write.SetAluOp(10);
-		IDEX_Write.SetAluSrc(0);
-		IDEX_Write.SetMemRead(0);
-		IDEX_Write.SetMemToReg(0);
-		IDEX_Write.SetMemWrite(0);
-		IDEX_Write.SetRegDest(1);
-		IDEX_Write.SetRegWrite(1);
-	}
-	else if (((IFID_Read.GetInstruction() & OPCODE_BM) >> OPCODE_SHIFT) == 0x20) // load byte
-	{
-		IDEX_Write.SetAluOp(00);
-		IDEX_Write.SetAluSrc(1);
-		IDEX_Write.SetMemRead(1);
-		IDEX_Write.SetMemToReg(1);
-		IDEX_Write.SetMemWrite(0);
-		IDEX_Write.SetRegDest(0);
-		IDEX_Write.SetRegWrite(1);
-	}
-	else if (((IFID_Read.GetInstruction() & OPCODE_BM) >> OPCODE_SHIFT) == 0x28) // store byte
-	{
-		IDEX_Write.SetAluOp(00);
-		IDEX_Write.SetAluSrc(1);
-		IDEX_Write.SetMemRead(0);
-		IDEX_Write.SetMemToReg(NULL); // using NULL here to denote that this value doesn't matter - still treated as 0
-		IDEX_Write.SetMemWrite(1);
-		IDEX_Write.SetRegDest(NULL); // using NULL here to denote that this value doesn't matter - still treated as 0
-		IDEX_Write.SetRegWrite(0);
+	uint32_t written[MAX_ISSUE_WIDTH]{}; // register each older slot of the bundle writes, 0 for none
+
+	stalled = false;
+	for (uint32_t slot{ 0x0 }; slot < Width(); ++slot)
+	{
+		const IFID & IFID_Read{ Read()[slot].ifid };
+		IDEX & IDEX_Write{ Write()[slot].idex };
+
+		if (!IFID_Read.IsValid()) // nothing fetched into the slot - the empty slot moves on as a bubble
+		{
+			IDEX_Write = IDEX();
+			continue;
+		}
+
+		const DecodedInstruction & decoded{ predecode.Lookup(IFID_Read.GetInstruction()) };
+		bool bundleHazard{ false };
+
+		for (uint32_t older{ 0x0 }; older < slot; ++older) { bundleHazard = bundleHazard || ReadsRegister(decoded, written[older]); }
+
+		if (bundleHazard || IsHazard(decoded))
+		{
+			Hold(slot);
+			return;
+		}
+
+		if ((decoded.control & CTRL_REG_WRITE) != 0x0)
+		{
+			written[slot] = (decoded.control & CTRL_REG_DEST) != 0x0 ? decoded.writeReg15_11 : decoded.writeReg20_16;
+		}
+
+		// fetch register information
+		IDEX_Write.SetReadReg1(decoded.readReg1);
+		IDEX_Write.SetReadReg1Value(ReadRegister(decoded.readReg1));
+		IDEX_Write.SetReadReg2Value(ReadRegister(decoded.readReg2));
+		IDEX_Write.SetWriteReg15_11(decoded.writeReg15_11);
+		IDEX_Write.SetWriteReg20_16(decoded.writeReg20_16);
+
+		IDEX_Write.SetFunction(decoded.function);
+		IDEX_Write.SetSignExtendedOffset(decoded.seOffset);
+		IDEX_Write.SetPc(IFID_Read.GetPc());
+
+		// set control lines from the predecoded control word, and whether fetch followed a predicted target
+		bool predictedTaken{ IFID_Read.IsPredictedTaken() };
+		IDEX_Write.SetControl(decoded.control | (predictedTaken ? CTRL_PREDICTED_TAKEN : 0x0));
+		IDEX_Write.SetAluControl(decoded.aluControl);
+
+		// branches carry their target on in the offset field; jumps need no registers, so they go right here,
+		// unless fetch already went to the target - the BTB is tagged with the full pc, so its target is right
+		uint32_t nextPc{ IFID_Read.GetPc() + 0x4 };
+		if ((decoded.control & CTRL_BRANCH) != 0x0)
+		{
+			IDEX_Write.SetSignExtendedOffset(BranchTarget(nextPc, decoded.seOffset));
+		}
+		else if ((decoded.control & CTRL_JUMP) != 0x0)
+		{
+			uint32_t target{ JumpTarget(nextPc, decoded.seOffset) };
+
+			IDEX_Write.SetReadReg1Value(static_cast<int32_t>(nextPc)); // jal writes $31 = return address + 0
+			IDEX_Write.SetSignExtendedOffset(0x0);
+			if (!predictedTaken)
+			{
+				predictor.Update(IFID_Read.GetPc(), true, target, false);
+				Redirect(target, false);
+
+				for (++slot; slot < Width(); ++slot) // the rest of the bundle is on the wrong path
+				{
+					if (Read()[slot].ifid.IsValid()) { ++counters.flushes; }
+					Write()[slot].idex = IDEX();
+				}
+			}
+		}
 	}
 }
 
-void Processor::ExecuteStage()
+//****************************************************************
+// Forward - forwarding unit: the newest value of a source        *
+// register still in flight, EX/MEM before MEM/WB and younger     *
+// slots before older ones, or the value read in decode when      *
+// none is writing it                                             *
+//****************************************************************
+template <class Config>
+int32_t Processor<Config>::Forward(uint32_t reg, int32_t value)
 {
-	// pass over control signals
-	EXMEM_Write.SetMemRead(IDEX_Read.GetMemRead());
-	EXMEM_Write.SetMemToReg(IDEX_Read.GetMemToReg());
-	EXMEM_Write.SetMemWrite(IDEX_Read.GetMemWrite());
-	EXMEM_Write.SetRegWrite(IDEX_Read.GetRegWrite());
+	if (!Config::FORWARDING || reg == 0x0) { return value; }
 
-	if (IDEX_Read.GetAluOp() == 10 && IDEX_Read.GetAluSrc() == 0) // r-format
+	for (uint32_t slot{ Width() }; slot-- > 0x0;)
 	{
-		EXMEM_Write.SetWriteRegNum(IDEX_Read.GetWriteReg15_11());
+		const EXMEM & mem{ Read()[slot].exmem };
 
-		if (IDEX_Read.GetFunction() == 0x20) // add instruction
+		if (mem.GetRegWrite() && mem.GetWriteRegNum() == reg) // a load here was stalled for, so this is an ALU result
 		{
-			EXMEM_Write.SetAluResult((IDEX_Read.GetReadReg1Value() + IDEX_Read.GetReadReg2Value()));
+			++counters.forwards;
+			return mem.GetAluResult();
 		}
-		else if (IDEX_Read.GetFunction() == 0x22) // subtract instruction
+	}
+
+	for (uint32_t slot{ Width() }; slot-- > 0x0;)
+	{
+		const MEMWB & wb{ Read()[slot].memwb };
+
+		if (wb.GetRegWrite() && wb.GetWriteRegNum() == reg)
 		{
-			EXMEM_Write.SetAluResult((IDEX_Read.GetReadReg1Value() - IDEX_Read.GetReadReg2Value()));
+			++counters.forwards;
+			return wb.GetMemToReg() ? wb.GetLoadByteValue() : wb.GetAluResult();
 		}
 	}
-	else
+
+	return value;
+}
+
+//*************************************************************
+// Execute stage - run the bundle slot by slot; a slot that   *
+// redirects fetch squashes the younger slots executing with  *
+// it                                                         *
+//*************************************************************
+template <class Config>
+void Processor<Config>::ExecuteStage()
+{
+	for (uint32_t slot{ 0x0 }; slot < Width(); ++slot)
 	{
-		EXMEM_Write.SetWriteRegNum(IDEX_Read.GetWriteReg20_16());
-		EXMEM_Write.SetAluResult((IDEX_Read.GetReadReg1Value() + IDEX_Read.GetSignExtendedOffset())); // alu_src == 1
+		if (!ExecuteSlot(slot)) { continue; }
+
+		for (++slot; slot < Width(); ++slot)
+		{
+			if (!Read()[slot].idex.IsBubble()) { ++counters.flushes; }
+			Write()[slot].exmem = EXMEM();
+		}
 	}
+}
+
+// ExecuteSlot - execute one slot of the bundle, returns true if it redirected fetch
+template <class Config>
+bool Processor<Config>::ExecuteSlot(uint32_t slot)
+{
+	const IDEX & IDEX_Read{ Read()[slot].idex };
+	EXMEM & EXMEM_Write{ Write()[slot].exmem };
+
+	// pass over control signals
+	EXMEM_Write.SetControl(IDEX_Read.GetControl());
+
+	int32_t operand1{ Forward(IDEX_Read.GetReadReg1(), IDEX_Read.GetReadReg1Value()) };
+	int32_t reg2Value{ IDEX_Read.UsesReadReg2() ? Forward(IDEX_Read.GetReadReg2(), IDEX_Read.GetReadReg2Value()) : IDEX_Read.GetReadReg2Value() };
 
-	EXMEM_Write.SetSendBackValue(IDEX_Read.GetReadReg2Value()); // this would be passed over in either case
+	// the second operand is the offset for loads/stores and immediates, register 2 otherwise;
+	// shifts move register 2 by the shift amount, which sits inside the offset field
+	int32_t operand2{ IDEX_Read.GetAluSrc() ? static_cast<int32_t>(IDEX_Read.GetSignExtendedOffset()) : reg2Value };
+	if (IsShift(IDEX_Read.GetAluControl()))
+	{
+		operand1 = reg2Value;
+		operand2 = static_cast<int32_t>((IDEX_Read.GetSignExtendedOffset() & SHAMT_BM) >> SHAMT_SHIFT);
+	}
+
+	int32_t result{ Alu(IDEX_Read.GetAluControl(), operand1, operand2) };
+
+	EXMEM_Write.SetWriteRegNum(IDEX_Read.GetRegDest() ? IDEX_Read.GetWriteReg15_11() : IDEX_Read.GetWriteReg20_16());
+	EXMEM_Write.SetAluResult(result);
+
+	EXMEM_Write.SetSendBackValue(reg2Value); // this would be passed over in either case
+
+	// a branch fetch guessed wrong squashes what was fetched after it, as does jr, which is never predicted
+	uint32_t control{ IDEX_Read.GetControl() };
+	if ((control & CTRL_BRANCH) != 0x0)
+	{
+		bool taken{ (result == 0x0) != ((control & CTRL_BRANCH_NE) != 0x0) };
+		uint32_t target{ IDEX_Read.GetSignExtendedOffset() };
+		bool mispredicted{ taken != IDEX_Read.IsPredictedTaken() };
+
+		++counters.conditionalBranches;
+		if (taken) { ++counters.takenBranches; }
+		if (mispredicted)
+		{
+			++counters.mispredictions;
+			Redirect(taken ? target : IDEX_Read.GetPc() + 0x4, true);
+		}
+
+		predictor.Update(IDEX_Read.GetPc(), taken, target, true);
+		return mispredicted;
+	}
+	else if ((control & CTRL_JUMP_REG) != 0x0)
+	{
+		++counters.takenBranches;
+		Redirect(static_cast<uint32_t>(operand1), true);
+		return true;
+	}
+	else if ((control & CTRL_JUMP) != 0x0)
+	{
+		++counters.takenBranches;
+	}
+	else if ((control & CTRL_UNSUPPORTED) != 0x0) // counted here, as nothing squashes an instruction once it has executed
+	{
+		++counters.unsupported;
+	}
+
+	return false;
 }
 
-void Processor::MemoryStage(int32_t * mainMem)
+//****************************************************************
+// AccessCache - run a load or store past the data cache, which  *
+// holds the pipeline for however many cycles the access costs;  *
+// the accesses of one bundle overlap, the slowest one counts    *
+//****************************************************************
+template <class Config>
+void Processor<Config>::AccessCache(int32_t address, bool write)
 {
+	if (!Config::DCACHE || !dcache.IsEnabled()) { return; }
+
+	uint32_t wait{ dcache.Access(static_cast<uint32_t>(address), write) };
+	if (wait > memoryWait) { memoryWait = wait; }
+
+	counters.dcacheHits = dcache.GetHits();
+	counters.dcacheMisses = dcache.GetMisses();
+	counters.dcacheWritebacks = dcache.GetWritebacks();
+}
+
+// Memory stage - every slot of the bundle in order, so a store is seen by a younger load of the same bundle
+template <class Config>
+void Processor<Config>::MemoryStage(SparseMemory & mainMem)
+{
+	for (uint32_t slot{ 0x0 }; slot < Width(); ++slot) { MemorySlot(slot, mainMem); }
+}
+
+//************************************************************
+// MemorySlot - loads sign extend the addressed byte,         *
+// halfword or word, stores write the low byte, halfword or   *
+// word of register 2, in main memory's byte order; addresses *
+// wrap at 4 GiB                                              *
+//************************************************************
+template <class Config>
+void Processor<Config>::MemorySlot(uint32_t slot, SparseMemory & mainMem)
+{
+	const EXMEM & EXMEM_Read{ Read()[slot].exmem };
+	MEMWB & MEMWB_Write{ Write()[slot].memwb };
+
 	// pass values over
-	MEMWB_Write.SetMemToReg(EXMEM_Read.GetMemToReg());
-	MEMWB_Write.SetRegWrite(EXMEM_Read.GetRegWrite());
+	MEMWB_Write.SetControl(EXMEM_Read.GetControl());
 	MEMWB_Write.SetWriteRegNum(EXMEM_Read.GetWriteRegNum());
 	MEMWB_Write.SetAluResult(EXMEM_Read.GetAluResult());
 
-	if (EXMEM_Read.GetMemRead() == 1) // load byte
+	uint32_t address{ static_cast<uint32_t>(EXMEM_Read.GetAluResult()) }, size{ MemAccessSize(EXMEM_Read.GetControl()) };
+
+	if (EXMEM_Read.GetMemRead() == 1) // load
+	{
+		MEMWB_Write.SetLoadByteValue(ExtendLoad(mainMem.Load(address, size), EXMEM_Read.GetControl())); // load the value from requested address
+		AccessCache(EXMEM_Read.GetAluResult(), false);
+		++counters.memoryReads;
+	}
+	else if (EXMEM_Read.GetMemWrite() == 1) // store
 	{
-		MEMWB_Write.SetLoadByteValue(mainMem[EXMEM_Read.GetAluResult()]); // load the value from requested address
+		mainMem.Store(address, static_cast<uint32_t>(EXMEM_Read.GetSendBackValue()), size);
+		AccessCache(EXMEM_Read.GetAluResult(), true);
+		++counters.memoryWrites;
+		MEMWB_Write.SetLoadByteValue(0x0); // I use 0x0 here to denote that this value doesn't matter
 	}
-	else if (EXMEM_Read.GetMemWrite() == 1) // store byte
+	else // no memory access - the write side is two cycles stale, so carry the last value forward
 	{
-		mainMem[EXMEM_Read.GetAluResult()] = EXMEM_Read.GetSendBackValue();
-		MEMWB_Write.SetLoadByteValue(NULL); // I use NULL here to denote that this value doesn't matter
+		MEMWB_Write.SetLoadByteValue(Read()[slot].memwb.GetLoadByteValue());
 	}
 }
 
-void Processor::WriteBackStage()
+// Write back stage - every slot of the bundle in order, so the youngest write to a register wins
+template <class Config>
+void Processor<Config>::WriteBackStage()
 {
+	for (uint32_t slot{ 0x0 }; slot < Width(); ++slot) { WriteBackSlot(slot); }
+}
+
+// WriteBackSlot - write back one slot of the bundle, and count what retires
+template <class Config>
+void Processor<Config>::WriteBackSlot(uint32_t slot)
+{
+	const MEMWB & MEMWB_Read{ Read()[slot].memwb };
+
 	if (MEMWB_Read.GetRegWrite() == 1)
 	{
-		if (MEMWB_Read.GetMemToReg() == 1) // load byte
+		if (MEMWB_Read.GetWriteRegNum() == 0x0) {} // $0 stays hardwired to zero
+		else if (MEMWB_Read.GetMemToReg() == 1) // load
 		{
 			Regs[MEMWB_Read.GetWriteRegNum()] = MEMWB_Read.GetLoadByteValue();
+			++counters.retiredLoads;
+		}
+		else if (MEMWB_Read.IsControlTransfer()) // jal
+		{
+			Regs[MEMWB_Read.GetWriteRegNum()] = MEMWB_Read.GetAluResult();
+			++counters.retiredBranches;
 		}
-		else // r-format
+		else // r-format or immediate
 		{
 			Regs[MEMWB_Read.GetWriteRegNum()] = MEMWB_Read.GetAluResult();
+			++counters.retiredRFormat;
 		}
+
+		++counters.registerWrites;
+	}
+	else if (MEMWB_Read.GetMemWrite()) // store
+	{
+		++counters.retiredStores;
+	}
+	else if (MEMWB_Read.IsControlTransfer())
+	{
+		++counters.retiredBranches;
+	}
+	else if (!MEMWB_Read.IsBubble())
+	{
+		++counters.retiredNoops;
 	}
 }
 
-//******************************************************
-// Print stage - print out everything... this is messy *
-//******************************************************
-void Processor::Print(std::ofstream & outputFile) const
+//***********************************************************
+// Print stage - snapshot every latch and register and hand *
+// it to the output sink, which formats or records it; of   *
+// a wider bundle only the oldest slot is shown             *
+//***********************************************************
+template <class Config>
+void Processor<Config>::Print(OutputSink & sink, uint64_t cycle) const
 {
-	outputFile << std::hex << std::uppercase;
-	outputFile << std::setw(79) << std::setfill('*') << '*';
-	outputFile << std::endl << std::endl << std::endl;
-
-	outputFile << "IF/ID Write: " << std::endl << std::endl;
-	outputFile << "\t Instruction: 0x" << std::setw(8) << std::setfill('0') << IFID_Write.GetInstruction(); 
-	outputFile << std::endl << std::endl << std::endl;
-
-	outputFile << "IF/ID Read: " << std::endl << std::endl;
-	outputFile << "\t Instruction: 0x" << std::setw(8) << std::setfill('0') << IFID_Read.GetInstruction();
-	outputFile << std::endl << std::endl << std::endl << std::endl;
-
-	outputFile << "ID/EX Write: " << std::endl << std::endl;
-	outputFile << "\t signExtendedOffset: 0x" << std::setw(8) << std::setfill('0') << IDEX_Write.GetSignExtendedOffset() << std::setfill(' ') << std::endl;
-	outputFile << "\t function: 0x" << IDEX_Write.GetFunction() << std::endl;
-	outputFile << "\t readReg1Value: 0x" << IDEX_Write.GetReadReg1Value();
-	outputFile << "\t readReg2Value: 0x" << IDEX_Write.GetReadReg2Value() << std::endl;
-	outputFile << "\t writeReg15_11: " << std::dec << IDEX_Write.GetWriteReg15_11();
-	outputFile << "\t writeReg20_16: " << IDEX_Write.GetWriteReg20_16() << std::endl;
-	outputFile << "\n\t control: aluOp: " << IDEX_Write.GetAluOp() << ", aluSrc: " << IDEX_Write.GetAluSrc();
-	outputFile << ", memRead: " << IDEX_Write.GetMemRead() << ", memToReg: " << IDEX_Write.GetMemToReg() << std::endl;
-	outputFile << "\t\t  memWrite: " << IDEX_Write.GetMemWrite() << ", regDst: " << IDEX_Write.GetRegDest();
-	outputFile << ", regWrite: " << IDEX_Write.GetRegWrite();
-	outputFile << std::endl << std::endl << std::endl << std::hex;
-
-	outputFile << "ID/EX Read: " << std::endl << std::endl;
-	outputFile << "\t signExtendedOffset: " << "0x" << std::setw(8) << std::setfill('0') << IDEX_Read.GetSignExtendedOffset() << std::setfill(' ') << std::endl;
-	outputFile << "\t function: 0x" << IDEX_Read.GetFunction() << std::endl;
-	outputFile << "\t readReg1Value: 0x" << IDEX_Read.GetReadReg1Value();
-	outputFile << "\t readReg2Value: 0x" << IDEX_Read.GetReadReg2Value() << std::endl;
-	outputFile << "\t writeReg15_11: " << std::dec << IDEX_Read.GetWriteReg15_11();
-	outputFile << "\t writeReg20_16: " << IDEX_Read.GetWriteReg20_16() << std::endl;
-	outputFile << "\n\t control: aluOp: " << IDEX_Read.GetAluOp() << ", aluSrc: " << IDEX_Read.GetAluSrc();
-	outputFile << ", memRead: " << IDEX_Read.GetMemRead() << ", memToReg: " << IDEX_Read.GetMemToReg() << std::endl;
-	outputFile << "\t\t  memWrite: " << IDEX_Read.GetMemWrite() << ", regDst: " << IDEX_Read.GetRegDest();
-	outputFile << ", regWrite: " << IDEX_Read.GetRegWrite();
-	outputFile << std::endl << std::endl << std::endl << std::hex;
-
-	outputFile << "EX/MEM Write: " << std::endl << std::endl;
-	outputFile << "\t aluResult: " << EXMEM_Write.GetAluResult() << ", storeByteValue: " << EXMEM_Write.GetSendBackValue() << std::dec;
-	outputFile << ", writeRegNum: " << EXMEM_Write.GetWriteRegNum() << std::endl;
-	outputFile << "\t control: memRead: " << EXMEM_Write.GetMemRead() << ", memToReg: " << EXMEM_Write.GetMemToReg();
-	outputFile << ", memWrite: " << EXMEM_Write.GetMemWrite() << ", regWrite: " << EXMEM_Write.GetRegWrite();
-	outputFile << std::endl << std::endl << std::endl << std::hex;
-
-	outputFile << "EX/MEM Read: " << std::endl << std::endl;
-	outputFile << "\t aluResult: " << EXMEM_Read.GetAluResult() << ", storeByteValue: " << EXMEM_Read.GetSendBackValue() << std::dec;
-	outputFile << ", writeRegNum: " << EXMEM_Read.GetWriteRegNum() << std::endl;
-	outputFile << "\t control: memRead: " << EXMEM_Read.GetMemRead() << ", memToReg: " << EXMEM_Read.GetMemToReg();
-	outputFile << ", memWrite: " << EXMEM_Read.GetMemWrite() << ", regWrite: " << EXMEM_Read.GetRegWrite();
-	outputFile << std::endl << std::endl << std::endl << std::hex;
-
-	outputFile << "MEM/WB Write: " << std::endl << std::endl;
-	outputFile << "\t aluResult: " << MEMWB_Write.GetAluResult() << ", loadByteValue: " << MEMWB_Write.GetLoadByteValue();
-	outputFile << std::dec << ", writeRegNum: " << MEMWB_Write.GetWriteRegNum() << std::endl << std::endl;
-	outputFile << "\t control: memToReg: " << MEMWB_Write.GetMemToReg() << ", regWrite: " << MEMWB_Write.GetRegWrite();
-	outputFile << std::endl << std::endl << std::endl << std::hex;
-
-	outputFile << "MEM/WB Read: " << std::endl << std::endl;
-	outputFile << "\t aluResult: " << MEMWB_Read.GetAluResult() << ", loadByteValue: " << MEMWB_Read.GetLoadByteValue();
-	outputFile << std::dec << ", writeRegNum: " << MEMWB_Read.GetWriteRegNum() << std::endl << std::endl;
-	outputFile << "\t control: memToReg: " << MEMWB_Read.GetMemToReg() << ", regWrite: " << MEMWB_Read.GetRegWrite();
-	outputFile << std::endl << std::endl << std::endl << std::hex;
-
-	outputFile << "Registers: " << std::endl << std::endl;
-	for (size_t i{ 0x0 }; i < 0x20; ++i)
-	{
-		if (i % 4 == 0) { outputFile << std::endl; } // formatting
-
-		if (Regs[i] < 0x10) // formatting
-		{
-			outputFile << std::setw(6) << std::dec << i << ": 0x" << std::hex << Regs[i] << "  ";
-		}
-		else if (Regs[i] < 0x100)
-		{
-			outputFile << std::setw(6) << std::dec << i << ": 0x" << std::hex << Regs[i] << " ";
-		}
-		else
+	PipelineSnapshot snapshot{};
+	const PipelineLatches & write{ latches[writeSide][0x0] };
+	const PipelineLatches & read{ Read()[0x0] };
+	const IDEX * idex[2]{ &write.idex, &read.idex };
+	const EXMEM * exmem[2]{ &write.exmem, &read.exmem };
+	const MEMWB * memwb[2]{ &write.memwb, &read.memwb };
+
+	snapshot.cycle = cycle;
+	snapshot.ifidInstruction[0] = write.ifid.GetInstruction();
+	snapshot.ifidInstruction[1] = read.ifid.GetInstruction();
+
+	for (size_t i{ 0x0 }; i < 2; ++i)
+	{
+		snapshot.idex[i].signExtendedOffset = idex[i]->GetSignExtendedOffset();
+		snapshot.idex[i].function = idex[i]->GetFunction();
+		snapshot.idex[i].writeReg15_11 = idex[i]->GetWriteReg15_11();
+		snapshot.idex[i].writeReg20_16 = idex[i]->GetWriteReg20_16();
+		snapshot.idex[i].aluOp = idex[i]->GetAluOp();
+		snapshot.idex[i].readReg1Value = idex[i]->GetReadReg1Value();
+		snapshot.idex[i].readReg2Value = idex[i]->GetReadReg2Value();
+		snapshot.idex[i].aluSrc = idex[i]->GetAluSrc();
+		snapshot.idex[i].memRead = idex[i]->GetMemRead();
+		snapshot.idex[i].memToReg = idex[i]->GetMemToReg();
+		snapshot.idex[i].memWrite = idex[i]->GetMemWrite();
+		snapshot.idex[i].regDest = idex[i]->GetRegDest();
+		snapshot.idex[i].regWrite = idex[i]->GetRegWrite();
+
+		snapshot.exmem[i].aluResult = exmem[i]->GetAluResult();
+		snapshot.exmem[i].storeByteValue = exmem[i]->GetSendBackValue();
+		snapshot.exmem[i].writeRegNum = exmem[i]->GetWriteRegNum();
+		snapshot.exmem[i].memRead = exmem[i]->GetMemRead();
+		snapshot.exmem[i].memToReg = exmem[i]->GetMemToReg();
+		snapshot.exmem[i].memWrite = exmem[i]->GetMemWrite();
+		snapshot.exmem[i].regWrite = exmem[i]->GetRegWrite();
+
+		snapshot.memwb[i].aluResult = memwb[i]->GetAluResult();
+		snapshot.memwb[i].loadByteValue = memwb[i]->GetLoadByteValue();
+		snapshot.memwb[i].writeRegNum = memwb[i]->GetWriteRegNum();
+		snapshot.memwb[i].memToReg = memwb[i]->GetMemToReg();
+		snapshot.memwb[i].regWrite = memwb[i]->GetRegWrite();
+	}
+
+	for (size_t i{ 0x0 }; i < 0x20; ++i) { snapshot.regs[i] = Regs[i]; }
+
+	sink.Write(snapshot);
+}
+
+//************************************************************
+// Copy stage - commit the cycle by flipping the write side, *
+// the latches just written become the ones read next cycle  *
+//************************************************************
+
+template <class Config>
+void Processor<Config>::Copy() { writeSide ^= 0x1; }
+
+//****************************************************************
+// IsDrained - true once nothing is left in flight: no slot of   *
+// the latches the next cycle reads holds an instruction and no  *
+// data cache wait is pending, so whatever went in has retired   *
+//****************************************************************
+template <class Config>
+bool Processor<Config>::IsDrained() const
+{
+	const PipelineLatches * next{ latches[writeSide] };
+
+	if (IsWaitingOnMemory()) { return false; }
+
+	for (uint32_t slot{ 0x0 }; slot < Width(); ++slot)
+	{
+		if (next[slot].ifid.IsValid() || !next[slot].idex.IsBubble() || !next[slot].exmem.IsBubble() || !next[slot].memwb.IsBubble()) { return false; }
+	}
+
+	return true;
+}
+
+//*****************************************************************
+// ExecuteFunctional - run the instruction at pc straight on Regs *
+// and memory, and move pc on, with the same semantics as the     *
+// pipeline but none of its latches; only valid while the         *
+// pipeline is empty, so the architectural state hands over       *
+// cleanly to the detailed stages                                 *
+//*****************************************************************
+template <class Config>
+void Processor<Config>::ExecuteFunctional(uint32_t instruction, SparseMemory & mainMem)
+{
+	DecodedInstruction decoded;
+	PredecodeCache::Decode(instruction, decoded); // decoding outright beats a cache lookup that may miss and refill
+	uint32_t dest{ (decoded.control & CTRL_REG_DEST) != 0x0 ? decoded.writeReg15_11 : decoded.writeReg20_16 };
+	uint32_t nextPc{ pc + 0x4 };
+
+	++counters.fastForwarded;
+	if ((decoded.control & CTRL_UNSUPPORTED) != 0x0) { ++counters.unsupported; }
+	pc = nextPc;
+
+	if ((decoded.control & CTRL_JUMP) != 0x0)
+	{
+		if ((decoded.control & CTRL_LINK) != 0x0) { Regs[LINK_REG] = static_cast<int32_t>(nextPc); }
+		pc = JumpTarget(nextPc, decoded.seOffset);
+		return;
+	}
+
+	int32_t operand1{ Regs[decoded.readReg1] }, reg2Value{ Regs[decoded.readReg2] };
+	int32_t operand2{ (decoded.control & CTRL_ALU_SRC) != 0x0 ? static_cast<int32_t>(decoded.seOffset) : reg2Value };
+	if (IsShift(decoded.aluControl))
+	{
+		operand1 = reg2Value;
+		operand2 = static_cast<int32_t>((decoded.seOffset & SHAMT_BM) >> SHAMT_SHIFT);
+	}
+
+	int32_t result{ Alu(decoded.aluControl, operand1, operand2) };
+	uint32_t size{ MemAccessSize(decoded.control) };
+
+	if ((decoded.control & CTRL_BRANCH) != 0x0)
+	{
+		if ((result == 0x0) != ((decoded.control & CTRL_BRANCH_NE) != 0x0)) { pc = BranchTarget(nextPc, decoded.seOffset); }
+	}
+	else if ((decoded.control & CTRL_JUMP_REG) != 0x0)
+	{
+		pc = static_cast<uint32_t>(operand1) & ~0x3;
+	}
+	else if ((decoded.control & CTRL_MEM_READ) != 0x0) // load
+	{
+		result = ExtendLoad(mainMem.Load(static_cast<uint32_t>(result), size), decoded.control);
+	}
+	else if ((decoded.control & CTRL_MEM_WRITE) != 0x0) // store
+	{
+		mainMem.Store(static_cast<uint32_t>(result), static_cast<uint32_t>(reg2Value), size);
+	}
+
+	if ((decoded.control & CTRL_REG_WRITE) != 0x0 && dest != 0x0) { Regs[dest] = result; }
+}
+
+//****************************************************************
+// SaveState - write the latches, registers, data cache and     *
+// branch predictor for a checkpoint; counters are left out, so *
+// a restored run counts only its own cycles, and the predecode *
+// cache refills itself                                         *
+//****************************************************************
+template <class Config>
+void Processor<Config>::SaveState(std::ostream & out) const
+{
+	WriteRaw(out, latches);
+	WriteRaw(out, writeSide);
+	WriteRaw(out, width);
+	WriteRaw(out, Regs);
+	WriteRaw(out, pc);
+	WriteRaw(out, memoryWait);
+	dcache.Save(out);
+	predictor.Save(out);
+}
+
+//*************************************************************
+// LoadState - read state written by SaveState, returns false *
+// if the checkpoint ends early or holds state no run could   *
+// have left; the run goes on at the issue width it was saved *
+// at, which the latches are laid out for, so a variant with  *
+// its width fixed only takes that one                        *
+//*************************************************************
+template <class Config>
+bool Processor<Config>::LoadState(std::istream & in)
+{
+	return ReadRaw(in, latches) && ReadRaw(in, writeSide) && ReadRaw(in, width) && IsValidState() && ReadRaw(in, Regs) && ReadRaw(in, pc) &&
+		ReadRaw(in, memoryWait) && dcache.Load(in) && predictor.Load(in);
+}
+
+//***************************************************************
+// IsValidState - whether the latches, write side and width just *
+// read could have come from a run: a write side of 0 or 1, a    *
+// width of 1, 2 or 4 that the variant takes, and every register *
+// number the latches carry below 32, so no stage indexes past   *
+// the register file                                             *
+//***************************************************************
+template <class Config>
+bool Processor<Config>::IsValidState() const
+{
+	if (writeSide > 0x1 || (width != 0x1 && width != 0x2 && width != MAX_ISSUE_WIDTH) || (Config::WIDTH != 0x0 && width != Config::WIDTH))
+	{
+		return false;
+	}
+
+	for (const auto & bundle : latches)
+	{
+		for (const PipelineLatches & slot : bundle)
 		{
-			outputFile << std::setw(6) << std::dec << i << ": 0x" << std::hex << Regs[i];
+			if (slot.idex.GetReadReg1() >= 0x20 || slot.idex.GetWriteReg15_11() >= 0x20 || slot.idex.GetWriteReg20_16() >= 0x20 ||
+				slot.exmem.GetWriteRegNum() >= 0x20 || slot.memwb.GetWriteRegNum() >= 0x20)
+			{
+				return false;
+			}
 		}
 	}
 
-	outputFile << std::endl << std::endl << std::endl;
+	return true;
 }
 
-//********************************************
-// Copy stage - copy write to read pipelines *
-//********************************************
-
-void Processor::Copy()
+//**************************************************************
+// Memory wait cycle - a cycle spent waiting on the data cache *
+// in place of a normal one, nothing in the pipeline moves     *
+//**************************************************************
+template <class Config>
+void Processor<Config>::MemoryWaitCycle()
 {
-	IFID_Read = IFID_Write;
-	IDEX_Read = IDEX_Write;
-	EXMEM_Read = EXMEM_Write;
-	MEMWB_Read = MEMWB_Write;
+	--memoryWait;
+	++counters.cycles;
+	++counters.memoryStallCycles;
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,246 @@
+#ifndef SPARSEMEMORY_H
+#define SPARSEMEMORY_H
+
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include "Checkpoint.h"
+
+// 4 KiB pages, found through a two level table covering the whole 32 bit address space
+const uint32_t
+	PAGE_BITS{ 12 },
+	PAGE_SIZE{ 0x1 << PAGE_BITS },
+	PAGE_OFFSET_BM{ PAGE_SIZE - 0x1 },
+	PAGE_TABLE_BITS{ 10 }, // pages per second level table
+	PAGE_TABLE_BM{ (0x1 << PAGE_TABLE_BITS) - 0x1 },
+	PAGE_DIRECTORY_SHIFT{ PAGE_BITS + PAGE_TABLE_BITS };
+
+struct MemoryPage
+{
+	uint8_t bytes[PAGE_SIZE];
+};
+
+//*******************************************************************
+// Sparse memory - byte addressable main memory over the full 32   *
+// bit address space; pages are allocated zeroed when first stored *
+// to, and reads of untouched pages return 0 without allocating    *
+// - bytes are kept in address order; halves and words are read   *
+//   and written in the program's byte order, big-endian unless a  *
+//   little-endian executable was loaded                            *
+//*******************************************************************
+class SparseMemory
+{
+private:
+	std::unique_ptr<std::unique_ptr<MemoryPage>[]> directory[0x1 << (32 - PAGE_DIRECTORY_SHIFT)];
+	mutable uint32_t lastPageNumber; // the last page looked up, so runs of nearby accesses skip the table walk
+	mutable MemoryPage * lastPage;
+	uint64_t pages; // pages allocated so far
+	bool bigEndian; // byte order of halves and words
+
+	MemoryPage * Find(uint32_t) const;
+	MemoryPage & Touch(uint32_t);
+public:
+	SparseMemory() : lastPageNumber(0x0), lastPage(nullptr), pages(0x0), bigEndian(true) {}
+	SparseMemory(const SparseMemory &) = delete;
+	SparseMemory & operator=(const SparseMemory &) = delete;
+
+	uint8_t LoadByte(uint32_t address) const
+	{
+		const MemoryPage * page{ Find(address) };
+		return page == nullptr ? 0x0 : page->bytes[address & PAGE_OFFSET_BM];
+	}
+
+	void StoreByte(uint32_t address, uint8_t val) { Touch(address).bytes[address & PAGE_OFFSET_BM] = val; }
+
+	uint32_t Load(uint32_t, uint32_t) const;
+	void Store(uint32_t, uint32_t, uint32_t);
+	void StoreBlock(uint32_t, const uint8_t *, uint64_t);
+
+	uint64_t GetPages() const { return pages; }
+	bool IsBigEndian() const { return bigEndian; }
+	void SetBigEndian(bool val) { bigEndian = val; }
+
+	bool FindDifference(const SparseMemory &, uint32_t &) const;
+
+	void Save(std::ostream &) const;
+	bool Load(std::istream &);
+};
+
+//***************************************************************
+// Find - the page holding an address, nullptr if never stored *
+//***************************************************************
+inline MemoryPage * SparseMemory::Find(uint32_t address) const
+{
+	uint32_t pageNumber{ address >> PAGE_BITS };
+
+	if (lastPage != nullptr && pageNumber == lastPageNumber) { return lastPage; }
+
+	const std::unique_ptr<std::unique_ptr<MemoryPage>[]> & table{ directory[address >> PAGE_DIRECTORY_SHIFT] };
+	if (!table) { return nullptr; }
+
+	MemoryPage * page{ table[pageNumber & PAGE_TABLE_BM].get() };
+	if (page != nullptr)
+	{
+		lastPageNumber = pageNumber;
+		lastPage = page;
+	}
+
+	return page;
+}
+
+//***********************************************************
+// Touch - the page holding an address, allocating it (and *
+// its second level table) zeroed on the first store       *
+//***********************************************************
+inline MemoryPage & SparseMemory::Touch(uint32_t address)
+{
+	MemoryPage * page{ Find(address) };
+	if (page != nullptr) { return *page; }
+
+	std::unique_ptr<std::unique_ptr<MemoryPage>[]> & table{ directory[address >> PAGE_DIRECTORY_SHIFT] };
+	if (!table) { table.reset(new std::unique_ptr<MemoryPage>[0x1 << PAGE_TABLE_BITS]); }
+
+	std::unique_ptr<MemoryPage> & slot{ table[(address >> PAGE_BITS) & PAGE_TABLE_BM] };
+	slot.reset(new MemoryPage);
+	memset(slot->bytes, 0x0, sizeof(slot->bytes));
+	++pages;
+
+	lastPageNumber = address >> PAGE_BITS;
+	lastPage = slot.get();
+
+	return *slot;
+}
+
+//****************************************************************
+// Load - read size (1, 2 or 4) bytes in the memory's byte       *
+// order; unaligned addresses are read byte by byte rather than  *
+// trapped                                                       *
+//****************************************************************
+inline uint32_t SparseMemory::Load(uint32_t address, uint32_t size) const
+{
+	uint32_t val{ 0x0 };
+
+	if (bigEndian)
+	{
+		for (uint32_t i{ 0x0 }; i < size; ++i) { val = (val << 8) | LoadByte(address + i); }
+	}
+	else
+	{
+		for (uint32_t i{ size }; i > 0x0; --i) { val = (val << 8) | LoadByte(address + i - 0x1); }
+	}
+
+	return val;
+}
+
+// Store - write the low size (1, 2 or 4) bytes of val in the memory's byte order
+inline void SparseMemory::Store(uint32_t address, uint32_t val, uint32_t size)
+{
+	for (uint32_t i{ 0x0 }; i < size; ++i)
+	{
+		uint32_t shift{ bigEndian ? 8 * (size - 0x1 - i) : 8 * i };
+		StoreByte(address + i, static_cast<uint8_t>(val >> shift));
+	}
+}
+
+//***************************************************************
+// StoreBlock - copy count bytes in, a page at a time, for      *
+// loading whole program segments; addresses wrap at 4 GiB      *
+//***************************************************************
+inline void SparseMemory::StoreBlock(uint32_t address, const uint8_t * bytes, uint64_t count)
+{
+	while (count != 0x0)
+	{
+		uint32_t offset{ address & PAGE_OFFSET_BM };
+		uint32_t chunk{ static_cast<uint32_t>(count < PAGE_SIZE - offset ? count : PAGE_SIZE - offset) };
+
+		memcpy(Touch(address).bytes + offset, bytes, chunk);
+		address += chunk;
+		bytes += chunk;
+		count -= chunk;
+	}
+}
+
+//***************************************************************
+// FindDifference - the lowest address whose byte differs from  *
+// the other memory's, a page only one side allocated reading   *
+// as zeros; returns false if the two hold the same bytes       *
+//***************************************************************
+inline bool SparseMemory::FindDifference(const SparseMemory & other, uint32_t & address) const
+{
+	static const MemoryPage zeros{};
+
+	for (uint32_t i{ 0x0 }; i < (0x1 << (32 - PAGE_DIRECTORY_SHIFT)); ++i)
+	{
+		if (!directory[i] && !other.directory[i]) { continue; }
+
+		for (uint32_t j{ 0x0 }; j < (0x1 << PAGE_TABLE_BITS); ++j)
+		{
+			const MemoryPage * mine{ directory[i] ? directory[i][j].get() : nullptr };
+			const MemoryPage * theirs{ other.directory[i] ? other.directory[i][j].get() : nullptr };
+
+			if (mine == nullptr && theirs == nullptr) { continue; }
+			if (mine == nullptr) { mine = &zeros; }
+			if (theirs == nullptr) { theirs = &zeros; }
+
+			for (uint32_t offset{ 0x0 }; offset < PAGE_SIZE; ++offset)
+			{
+				if (mine->bytes[offset] == theirs->bytes[offset]) { continue; }
+
+				address = (((i << PAGE_TABLE_BITS) | j) << PAGE_BITS) | offset;
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+//***************************************************************
+// Save - write the byte order and page count, then each        *
+// allocated page as its page number and contents               *
+//***************************************************************
+inline void SparseMemory::Save(std::ostream & out) const
+{
+	WriteRaw(out, bigEndian);
+	WriteRaw(out, pages);
+
+	for (uint32_t i{ 0x0 }; i < (0x1 << (32 - PAGE_DIRECTORY_SHIFT)); ++i)
+	{
+		if (!directory[i]) { continue; }
+
+		for (uint32_t j{ 0x0 }; j < (0x1 << PAGE_TABLE_BITS); ++j)
+		{
+			if (!directory[i][j]) { continue; }
+
+			WriteRaw(out, (i << PAGE_TABLE_BITS) | j);
+			WriteRaw(out, *directory[i][j]);
+		}
+	}
+}
+
+//************************************************************
+// Load - replace the contents with pages written by Save,   *
+// returns false if the stream ends early                    *
+//************************************************************
+inline bool SparseMemory::Load(std::istream & in)
+{
+	uint64_t count{ 0x0 };
+
+	for (auto & table : directory) { table.reset(); }
+	lastPage = nullptr;
+	pages = 0x0;
+
+	if (!ReadRaw(in, bigEndian) || !ReadRaw(in, count)) { return false; }
+
+	for (uint64_t i{ 0x0 }; i < count; ++i)
+	{
+		uint32_t pageNumber{ 0x0 };
+		if (!ReadRaw(in, pageNumber) || !ReadRaw(in, Touch(pageNumber << PAGE_BITS))) { return false; }
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//********************************************************************
+// Work stealing pool - every worker owns a deque of task indices,  *
+// works from the back of its own and steals from the front of the  *
+// others once it runs dry; the task set is fixed up front, so a    *
+// worker that finds every deque empty is done                      *
+//********************************************************************
+class WorkStealingPool
+{
+private:
+	struct WorkQueue
+	{
+		std::mutex lock;
+		std::deque<size_t> tasks;
+	};
+
+	std::vector<std::unique_ptr<WorkQueue>> queues;
+	std::atomic<uint64_t> steals;
+
+	bool Pop(size_t, size_t &);
+	bool Steal(size_t, size_t &);
+	template <class Function> void Work(size_t, Function &);
+public:
+	explicit WorkStealingPool(size_t);
+
+	template <class Function> void Run(size_t, Function);
+
+	size_t GetWorkers() const { return queues.size(); }
+	uint64_t GetSteals() const { return steals; }
+};
+
+WorkStealingPool::WorkStealingPool(size_t workers) : steals(0x0)
+{
+	if (workers == 0x0) { workers = 0x1; }
+
+	for (size_t i{ 0x0 }; i < workers; ++i) { queues.emplace_back(new WorkQueue); }
+}
+
+// take the newest task from the worker's own deque
+bool WorkStealingPool::Pop(size_t worker, size_t & task)
+{
+	WorkQueue & queue{ *queues[worker] };
+	std::lock_guard<std::mutex> guard(queue.lock);
+
+	if (queue.tasks.empty()) { return false; }
+
+	task = queue.tasks.back();
+	queue.tasks.pop_back();
+
+	return true;
+}
+
+// take the oldest task from the first other worker that has one
+bool WorkStealingPool::Steal(size_t worker, size_t & task)
+{
+	for (size_t i{ 0x1 }; i < queues.size(); ++i)
+	{
+		WorkQueue & victim{ *queues[(worker + i) % queues.size()] };
+		std::lock_guard<std::mutex> guard(victim.lock);
+
+		if (!victim.tasks.empty())
+		{
+			task = victim.tasks.front();
+			victim.tasks.pop_front();
+			++steals;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+template <class Function>
+void WorkStealingPool::Work(size_t worker, Function & function)
+{
+	size_t task{ 0x0 };
+
+	while (Pop(worker, task) || Steal(worker, task)) { function(task); }
+}
+
+//*****************************************************************
+// Run - call function(task) for every task in [0, tasks), spread *
+// over the workers, and return once all of them have finished;   *
+// the calling thread works as worker 0                           *
+//*****************************************************************
+template <class Function>
+void WorkStealingPool::Run(size_t tasks, Function function)
+{
+	std::vector<std::thread> threads;
+
+	for (size_t i{ 0x0 }; i < tasks; ++i) { queues[i % queues.size()]->tasks.push_back(i); }
+
+	for (size_t i{ 0x1 }; i < queues.size(); ++i) { threads.emplace_back([this, i, &function] { Work(i, function); }); }
+
+	Work(0x0, function);
+
+	for (std::thread & thread : threads) { thread.join(); }
+}
+
+#endif
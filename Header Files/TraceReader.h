@@ -0,0 +1,115 @@
+#ifndef TRACEREADER_H
+#define TRACEREADER_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <istream>
+#include <string>
+#include <vector>
+
+const uint64_t
+	TRACE_WINDOW_WORDS{ 0x1000 }, // most recently read words kept, a power of two
+	TRACE_MARK_WORDS{ 0x400 }; // words between the file offsets kept for seeking back past the window
+
+static_assert((TRACE_WINDOW_WORDS & (TRACE_WINDOW_WORDS - 0x1)) == 0x0 && TRACE_MARK_WORDS <= TRACE_WINDOW_WORDS,
+	"a rewind to a mark must leave its target in the window");
+
+//********************************************************************
+// Text trace reader - streams one hex instruction per line from the *
+// input file as fetch asks for it, word i at address 4 * i          *
+// - the last TRACE_WINDOW_WORDS words read stay in a ring, so loops *
+//   branch back to them without touching the file                  *
+// - every TRACE_MARK_WORDS words the file offset is noted, so a     *
+//   jump further back seeks to the mark before it and reads on from *
+//   there; memory stays bounded by the window, plus one offset per  *
+//   mark, however long the trace                                   *
+//********************************************************************
+class TraceReader
+{
+private:
+	std::istream & input;
+	std::string line; // reused for every line to avoid reallocating
+	std::vector<uint32_t> window; // word i at window[i % TRACE_WINDOW_WORDS]
+	std::vector<std::streampos> marks; // file offset of word k * TRACE_MARK_WORDS
+	uint64_t first, end; // words [first, end) are in the window
+	uint64_t position; // index of the next word to hand out
+
+	bool ReadWord();
+	bool Rewind(uint64_t);
+public:
+	explicit TraceReader(std::istream & in) : input(in), window(TRACE_WINDOW_WORDS), first(0x0), end(0x0), position(0x0) {}
+	bool Next(uint32_t &);
+	bool Seek(uint64_t);
+};
+
+//******************************************************************
+// ReadWord - parse one more line into the window, pushing out the *
+// oldest word once it is full; false at the end of the file       *
+//******************************************************************
+bool TraceReader::ReadWord()
+{
+	if (end % TRACE_MARK_WORDS == 0x0 && end / TRACE_MARK_WORDS == marks.size()) { marks.push_back(input.tellg()); }
+
+	if (!getline(input, line)) { return false; }
+
+	window[end & (TRACE_WINDOW_WORDS - 0x1)] = static_cast<uint32_t>(strtoul(line.c_str(), NULL, 16));
+	if (++end - first > TRACE_WINDOW_WORDS) { ++first; }
+
+	return true;
+}
+
+//*****************************************************************
+// Rewind - refill the window from the mark before target, which  *
+// has already left it; returns false if the input cannot seek    *
+//*****************************************************************
+bool TraceReader::Rewind(uint64_t target)
+{
+	uint64_t mark{ target / TRACE_MARK_WORDS };
+
+	if (marks[mark] == std::streampos(-1)) { return false; }
+
+	input.clear();
+	if (!input.seekg(marks[mark])) { return false; }
+	first = end = mark * TRACE_MARK_WORDS;
+
+	while (end < target)
+	{
+		if (!ReadWord()) { return false; }
+	}
+
+	return true;
+}
+
+//*****************************************************
+// Next - hand out the word at the current position,  *
+// returns false once the end of the trace is reached *
+//*****************************************************
+bool TraceReader::Next(uint32_t & instruction)
+{
+	if (position == end && !ReadWord()) { return false; }
+
+	instruction = window[position++ & (TRACE_WINDOW_WORDS - 0x1)];
+
+	return true;
+}
+
+//************************************************************
+// Seek - move to the word at position, reading ahead to it, *
+// or back to it from a mark once it has left the window;    *
+// returns false if the trace ends first                     *
+//************************************************************
+bool TraceReader::Seek(uint64_t target)
+{
+	if (target < first && !Rewind(target)) { return false; }
+
+	while (end < target)
+	{
+		if (!ReadWord()) { return false; }
+	}
+
+	position = target;
+
+	return true;
+}
+
+#endif
@@ -1,47 +1,894 @@
+#include <chrono>
 #include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
+#include "Benchmark.h"
+#include "BinaryImage.h"
+#include "CoSimulation.h"
+#include "ElfImage.h"
+#include "EventTrace.h"
+#include "LaneEngine.h"
+#include "Options.h"
 #include "Processor.h"
+#include "ThreadPool.h"
+#include "TraceReader.h"
 
-void InitializeMainMemory(int32_t *, const uint32_t);
-size_t LoadInputFile(std::ifstream &);
+void InitializeMainMemory(SparseMemory &, const uint32_t);
+std::string LoadInputFile(std::ifstream &);
 void LoadOutputFile(std::ofstream &);
-void CleanUp(std::ofstream &, uint32_t *);
+bool OpenInputFile(std::ifstream &, const std::string &);
+bool OpenOutputFile(std::ofstream &, const std::string &, std::ios::openmode);
+bool ParseCommandLine(int, char * [], SimulationOptions &);
+bool LoadManifest(const std::string &, std::vector<BatchJob> &);
+bool LoadLaneStates(const std::string &, std::vector<LaneState> &);
+void PrintUsage(const char *);
+bool ConvertTextTrace(const SimulationOptions &);
+void CleanUp(std::ofstream &);
 
-int main()
+// what a run reports back once its machine is gone, to main or the batch runner
+struct JobResult
 {
-	Processor processor;
-	uint32_t * inputInstructions{ nullptr };
-	int32_t mainMemory[0x400]{ 0x0 };
+	bool ok{ false };
+	uint64_t cycles{ 0x0 };
+	double seconds{ 0.0 };
+	PerformanceCounters counters;
+};
+
+//****************************************************************
+// Fetch buffer - the trace words from word address base on,     *
+// kept so that the part of a bundle decode held, or a branch a  *
+// few words ahead, is fetched again without seeking the trace   *
+//****************************************************************
+struct FetchBuffer
+{
+	uint32_t words[MAX_ISSUE_WIDTH];
+	uint64_t base;
+	uint32_t count;
+};
+
+//******************************************************************
+// Refill - line the fetch buffer up with pc, seeking the trace    *
+// only when pc left the words already read, and top it up to      *
+// width words; returns false if there is nothing to fetch at pc   *
+//******************************************************************
+template <class Trace>
+inline bool Refill(FetchBuffer & buffer, Trace & trace, uint32_t pc, uint32_t width)
+{
+	uint64_t position{ pc >> 2 };
+
+	if (position == buffer.base + buffer.count) // every word went in, the straight-line case - read on
+	{
+		buffer.count = 0x0;
+	}
+	else if (position >= buffer.base && position < buffer.base + buffer.count)
+	{
+		uint32_t used{ static_cast<uint32_t>(position - buffer.base) };
+
+		for (uint32_t i{ used }; i < buffer.count; ++i) { buffer.words[i - used] = buffer.words[i]; }
+		buffer.count -= used;
+	}
+	else
+	{
+		buffer.count = 0x0;
+		if (!trace.Seek(position)) { buffer.base = UINT64_MAX; return false; } // nothing read, so the next refill seeks again
+	}
+
+	buffer.base = position;
+	while (buffer.count < width && trace.Next(buffer.words[buffer.count])) { ++buffer.count; }
+
+	return buffer.count != 0x0;
+}
+
+//******************************************************************
+// Simulate - fetch instructions from the trace at the processor's *
+// pc through the pipeline, a bundle per cycle, from firstCycle    *
+// until the trace or cycle limit ends, returns the cycle the run  *
+// stopped at and sets tracePosition to the trace word the next    *
+// fetch reads; what decode held is fetched again, a predicted     *
+// target, jump or mispredicted branch moves fetch, and while the  *
+// data cache is busy the whole pipeline waits; past the end of    *
+// the trace nothing is fetched, and the run drains until every    *
+// instruction in flight has retired, unless a jump or branch      *
+// leads back into the trace; events, when given, records          *
+// what every stage held, and checker, when given, stops the run   *
+// at the first retired result the reference model disagrees with  *
+//******************************************************************
+template <class Config, class Trace>
+uint64_t Simulate(Processor<Config> & processor, Trace & trace, SparseMemory & mainMemory, OutputSink & sink, const uint64_t firstCycle,
+	const uint64_t cycleLimit, uint64_t & tracePosition, EventRecorder * events = nullptr, Checker<Config, Trace> * checker = nullptr)
+{
+	FetchBuffer buffer{ {}, processor.GetPc() >> 2, 0x0 };
+	uint64_t cycle{ firstCycle };
+	bool fetched{ trace.Seek(buffer.base) && Refill(buffer, trace, processor.GetPc(), processor.GetIssueWidth()) };
+
+	// latches are committed at the top of the cycle, so once the loop ends the
+	// processor still holds exactly the state the last cycle would print
+	for (; (cycleLimit == 0 || cycle - firstCycle < cycleLimit) && (fetched || !processor.IsDrained()) &&
+		(!Config::OBSERVED || checker == nullptr || !checker->HasDiverged()); ++cycle)
+	{
+		if (processor.IsWaitingOnMemory())
+		{
+			processor.MemoryWaitCycle();
+			if (Config::OBSERVED && sink.IsDue(cycle)) { processor.Print(sink, cycle); }
+			continue;
+		}
+
+		uint32_t fetchPc{ processor.GetPc() };
+
+		processor.Copy();
+		processor.InstructionFetchStage(buffer.words, fetched ? buffer.count : 0x0);
+		processor.InstructionDecodeStage();
+		processor.ExecuteStage();
+		processor.MemoryStage(mainMemory);
+		processor.WriteBackStage();
+		if (Config::OBSERVED) // dumps, events and the checker only exist in the variants compiled to watch the run
+		{
+			if (sink.IsDue(cycle)) { processor.Print(sink, cycle); }
+			if (events != nullptr)
+			{
+				events->Record(cycle, fetched, fetchPc, buffer.words[0x0], processor.GetDecodeInput(), processor.GetExecuteInput(),
+					processor.IsStalled());
+			}
+			if (checker != nullptr) { checker->Check(processor, mainMemory, cycle); }
+		}
+		fetched = Refill(buffer, trace, processor.GetPc(), processor.GetIssueWidth());
+	}
+
+	if (sink.WantsFinal() && cycle > firstCycle) { processor.Print(sink, cycle - 1); }
+	if (events != nullptr) { events->Finish(cycle); }
+
+	tracePosition = processor.GetPc() >> 2; // pc is still at a fetched instruction waiting to go in
+
+	return cycle;
+}
+
+//****************************************************************
+// FastForward - execute up to count instructions from the       *
+// processor's pc on the functional model, following its jumps   *
+// and branches, returns how many were executed                  *
+//****************************************************************
+template <class Config, class Trace>
+uint64_t FastForward(Processor<Config> & processor, Trace & trace, SparseMemory & mainMemory, const uint64_t count)
+{
+	uint32_t instruction{ 0x0 };
+	uint64_t executed{ 0x0 };
+
+	for (; executed < count && trace.Seek(processor.GetPc() >> 2) && trace.Next(instruction); ++executed)
+	{
+		processor.ExecuteFunctional(instruction, mainMemory);
+	}
+
+	return executed;
+}
+
+//******************************************************************
+// SaveCheckpoint - write the whole machine to a checkpoint file, *
+// returns false if it could not be written                       *
+//******************************************************************
+template <class Config>
+bool SaveCheckpoint(const std::string & filename, const Processor<Config> & processor, const SparseMemory & mainMemory, uint64_t cycle,
+	uint64_t tracePosition)
+{
+	std::ofstream checkpointFile;
+	CheckpointHeader header{};
+
+	if (!OpenOutputFile(checkpointFile, filename, std::ios::binary)) { return false; }
+
+	memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+	header.version = CHECKPOINT_VERSION;
+	header.cycle = cycle;
+	header.tracePosition = tracePosition;
+
+	WriteRaw(checkpointFile, header);
+	processor.SaveState(checkpointFile);
+	mainMemory.Save(checkpointFile);
+	checkpointFile.close();
+
+	if (checkpointFile.fail())
+	{
+		std::cerr << "Error: failed writing checkpoint: " << filename << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+//*****************************************************************
+// LoadCheckpoint - restore the whole machine from a checkpoint, *
+// returns false (with a message) if the file is not valid       *
+//*****************************************************************
+template <class Config>
+bool LoadCheckpoint(const std::string & filename, Processor<Config> & processor, SparseMemory & mainMemory, CheckpointHeader & header)
+{
+	std::ifstream checkpointFile(filename, std::ios::binary);
+
+	if (!ReadRaw(checkpointFile, header) || memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0 ||
+		header.version != CHECKPOINT_VERSION)
+	{
+		std::cerr << "Error: not a version " << CHECKPOINT_VERSION << " checkpoint: " << filename << std::endl;
+		return false;
+	}
+
+	if (!processor.LoadState(checkpointFile) || !mainMemory.Load(checkpointFile))
+	{
+		std::cerr << "Error: truncated or corrupt checkpoint: " << filename << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+//****************************************************************
+// WriteEvents - write the recorded pipeline events to the event *
+// trace file, if one was asked for, returns false if it could   *
+// not be written                                                *
+//****************************************************************
+bool WriteEvents(const SimulationOptions & options, const EventRecorder * events)
+{
+	std::ofstream eventsFile;
+
+	if (events == nullptr) { return true; }
+	if (!OpenOutputFile(eventsFile, options.eventsPath, std::ios::out)) { return false; }
+
+	events->Write(eventsFile);
+	eventsFile.close();
+	if (events->GetDropped() != 0x0 && options.verbose)
+	{
+		std::cout << "event trace kept the last " << options.eventCapacity << " events, " << events->GetDropped() << " dropped" << std::endl;
+	}
+
+	return !eventsFile.fail();
+}
+
+//***********************************************************
+// FinishCheck - report how the co-simulation went, if there *
+// was one, after a run of cycles; returns false if the      *
+// pipeline diverged from the reference model                *
+//***********************************************************
+template <class Config, class Cosimulation>
+bool FinishCheck(const SimulationOptions & options, Cosimulation * checker, const Processor<Config> & processor, uint64_t cycles)
+{
+	if (checker == nullptr) { return true; }
+
+	if (!checker->Finish(processor, options.cycleLimit == 0x0 || cycles < options.cycleLimit)) // the trace ended before the limit
+	{
+		std::cerr << "Error: " << checker->GetDivergence();
+		return false;
+	}
+
+	if (options.verbose) { std::cout << "co-simulation: " << checker->GetChecked() << " retired instructions matched the reference model" << std::endl; }
+
+	return true;
+}
+
+//******************************************************************
+// CompareFunctional - run the trace functionally from the state  *
+// the pipelined run started in, saved in start, and compare the  *
+// registers and main memory the two runs left behind; returns    *
+// false (with a message) at the first difference                 *
+//******************************************************************
+template <class Config, class Trace>
+bool CompareFunctional(const SimulationOptions & options, std::stringstream & start, const Processor<Config> & processor, Trace & trace,
+	const SparseMemory & mainMemory)
+{
+	std::unique_ptr<Processor<Config>> functional(new Processor<Config>);
+	SparseMemory functionalMemory;
+	uint32_t address{ 0x0 };
+
+	functional->LoadState(start); // written by this run, so it reads back whole
+	functionalMemory.Load(start);
+	uint64_t executed{ FastForward(*functional, trace, functionalMemory, UINT64_MAX) };
+
+	for (uint32_t reg{ 0x0 }; reg < 0x20; ++reg)
+	{
+		if (processor.GetRegister(reg) == functional->GetRegister(reg)) { continue; }
+
+		std::cerr << "Error: the pipelined and functional runs ended with different registers: $" << reg << " = 0x" << std::hex
+			<< processor.GetRegister(reg) << " pipelined, 0x" << functional->GetRegister(reg) << " functional" << std::dec << std::endl;
+		return false;
+	}
+
+	if (mainMemory.FindDifference(functionalMemory, address))
+	{
+		std::cerr << "Error: the pipelined and functional runs ended with different memory: byte 0x" << std::hex
+			<< static_cast<uint32_t>(mainMemory.LoadByte(address)) << " at 0x" << address << " pipelined, 0x"
+			<< static_cast<uint32_t>(functionalMemory.LoadByte(address)) << " functional" << std::dec << std::endl;
+		return false;
+	}
+
+	if (options.verbose) { std::cout << "functional run: " << executed << " instructions, same registers and memory as the pipeline" << std::endl; }
+
+	return true;
+}
+
+//*************************************************************
+// RunTrace - simulate a trace, resuming from a checkpoint or  *
+// fast forwarding through its start first, and saving a       *
+// checkpoint and the event trace at the end when asked to;    *
+// checkTrace, a second reader of the same trace, feeds the    *
+// reference model when the run is checked, and a run compared *
+// with the functional model replays trace once it drains;     *
+// returns false on an error or a divergence                   *
+//*************************************************************
+template <class Config, class Trace>
+bool RunTrace(Processor<Config> & processor, Trace & trace, Trace & checkTrace, SparseMemory & mainMemory, OutputSink & sink,
+	const SimulationOptions & options, uint64_t & cycles)
+{
+	CheckpointHeader header{};
+	uint64_t tracePosition{ 0x0 };
+
+	if (!options.restorePath.empty())
+	{
+		if (!LoadCheckpoint(options.restorePath, processor, mainMemory, header)) { return false; }
+
+		if (!trace.Seek(processor.GetPc() >> 2))
+		{
+			std::cerr << "Error: the trace ends before the checkpoint's position" << std::endl;
+			return false;
+		}
+	}
+
+	uint64_t fastForwarded{ FastForward(processor, trace, mainMemory, options.fastForward) };
+	std::unique_ptr<EventRecorder> events(options.eventsPath.empty() ? nullptr : new EventRecorder(options.eventCapacity));
+	std::unique_ptr<Checker<Config, Trace>> checker(options.check ? new Checker<Config, Trace>(checkTrace) : nullptr);
+
+	std::stringstream start; // the checkpoint format doubles as a deep copy
+
+	if (checker) { checker->Start(processor, mainMemory); } // after fast forwarding, the pipeline is still empty
+	if (options.compareFunctional)
+	{
+		processor.SaveState(start);
+		mainMemory.Save(start);
+	}
+
+	cycles = Simulate(processor, trace, mainMemory, sink, header.cycle, options.cycleLimit, tracePosition, events.get(), checker.get());
+
+	// a purely functional run, or one restored after its trace had already drained, still dumps the state it left behind
+	if (cycles == header.cycle && (fastForwarded != 0x0 || !options.restorePath.empty()) && (sink.WantsFinal() || sink.IsDue(cycles)))
+	{
+		processor.Print(sink, cycles);
+	}
+
+	bool saved{ (options.savePath.empty() || SaveCheckpoint(options.savePath, processor, mainMemory, cycles, tracePosition)) &&
+		WriteEvents(options, events.get()) };
+
+	bool checked{ FinishCheck(options, checker.get(), processor, cycles - header.cycle) };
+	bool matched{ !options.compareFunctional || CompareFunctional(options, start, processor, trace, mainMemory) };
+
+	return checked && matched && saved;
+}
+
+//****************************************************************
+// WriteStats - write the counter summary to the stats file, if  *
+// one was asked for, returns false if it could not be written   *
+//****************************************************************
+bool WriteStats(const SimulationOptions & options, const std::string & workload, const PerformanceCounters & counters)
+{
+	std::ofstream statsFile;
+
+	if (options.statsPath.empty()) { return true; }
+	if (!OpenOutputFile(statsFile, options.statsPath, std::ios::out)) { return false; }
+
+	WriteCounters(statsFile, options.statsFormat, workload, counters);
+	statsFile.close();
+
+	return !statsFile.fail();
+}
+
+// sniff the input format - binary images and ELF executables are mapped, text traces are streamed
+bool HasMagic(std::ifstream & inputFile, bool (*isFormat)(const char *, size_t))
+{
+	char magic[0x4]{};
+	inputFile.read(magic, sizeof(magic));
+	bool matches{ isFormat(magic, static_cast<size_t>(inputFile.gcount())) };
+	inputFile.clear();
+	inputFile.seekg(0, std::ios::beg);
+
+	return matches;
+}
+
+bool IsImageFile(std::ifstream & inputFile) { return HasMagic(inputFile, BinaryImage::IsImage); }
+bool IsElfFile(std::ifstream & inputFile) { return HasMagic(inputFile, ElfImage::IsElf); }
+
+// ConfigureProcessor - size the data cache, branch predictor and issue width, returns false (with a message) if one is invalid
+template <class Config>
+bool ConfigureProcessor(Processor<Config> & processor, const SimulationOptions & options)
+{
+	if (!processor.ConfigureCache(options.dcache))
+	{
+		std::cerr << "Error: invalid data cache geometry" << std::endl;
+		return false;
+	}
+	if (!processor.ConfigurePredictor(options.predictor))
+	{
+		std::cerr << "Error: invalid branch predictor size" << std::endl;
+		return false;
+	}
+	if (!processor.SetIssueWidth(options.issueWidth))
+	{
+		std::cerr << "Error: the issue width must be 1, 2 or 4" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+//*******************************************************************
+// SimulateFiles - set the machine up, simulate the opened input   *
+// into the opened output and write the counters if asked to,      *
+// returns false on an error                                       *
+//*******************************************************************
+template <class Config>
+bool SimulateFiles(const SimulationOptions & options, std::ifstream & inputFile, std::ofstream & outputFile, Processor<Config> & processor,
+	SparseMemory & mainMemory, uint64_t & cycles)
+{
+	bool isElf{ IsElfFile(inputFile) };
+
+	if (!isElf) { InitializeMainMemory(mainMemory, 0x400); } // an executable brings its own data
+	if (!ConfigureProcessor(processor, options)) { return false; }
+
+	OutputSink sink(outputFile, options);
+
+	if (isElf)
+	{
+		inputFile.close();
+
+		ElfImage elf;
+		if (!elf.Open(options.inputPath) || !elf.SeedMemory(mainMemory)) { return false; }
+
+		processor.SetPc(elf.GetEntry());
+		processor.SetRegister(STACK_REG, static_cast<int32_t>(ELF_STACK_TOP));
+
+		ElfTraceReader trace(elf), checkTrace(elf);
+		if (!RunTrace(processor, trace, checkTrace, mainMemory, sink, options, cycles)) { return false; }
+	}
+	else if (IsImageFile(inputFile))
+	{
+		inputFile.close();
+
+		BinaryImage image;
+		if (!image.Open(options.inputPath) || !image.SeedMemory(mainMemory)) { return false; }
+
+		ImageTraceReader trace(image), checkTrace(image);
+		if (!RunTrace(processor, trace, checkTrace, mainMemory, sink, options, cycles)) { return false; }
+	}
+	else
+	{
+		std::ifstream checkFile; // the reference model reads the text trace through a stream of its own
+		if (options.check && !OpenInputFile(checkFile, options.inputPath)) { return false; }
+
+		TraceReader trace(inputFile), checkTrace(checkFile);
+		if (!RunTrace(processor, trace, checkTrace, mainMemory, sink, options, cycles)) { return false; }
+		inputFile.close();
+	}
+
+	sink.Flush();
+	CleanUp(outputFile);
+
+	return WriteStats(options, options.inputPath, processor.GetCounters());
+}
+
+//*****************************************************************
+// Dispatch - pick the processor variant compiled for the options' *
+// feature choices and hand it to run; every variant is its own    *
+// instantiation of the pipeline and the cycle loop, so none of    *
+// these choices is tested again once the run starts; an observed  *
+// run spends its cycles dumping and checking, so only unobserved  *
+// ones get a variant with the issue width fixed at 1              *
+//*****************************************************************
+template <class Run>
+bool Dispatch(const SimulationOptions & options, Run & run)
+{
+	bool cached{ options.dcache.size != 0x0 };
+	bool observed{ options.outputLevel == OutputLevel::Cycle || options.outputLevel == OutputLevel::Interval || !options.eventsPath.empty() ||
+		options.check };
+	bool single{ !observed && options.issueWidth == 0x1 && options.restorePath.empty() }; // a restored run goes on at the checkpoint's width
+	uint32_t variant{ (options.forwarding ? 0x8u : 0x0u) | (cached ? 0x4u : 0x0u) | (observed ? 0x2u : 0x0u) | (single ? 0x1u : 0x0u) };
+
+	switch (variant)
+	{
+	case 0x0: return run.template Go<PipelineConfig<false, false, false, 0x0>>();
+	case 0x1: return run.template Go<PipelineConfig<false, false, false, 0x1>>();
+	case 0x2: return run.template Go<PipelineConfig<false, false, true, 0x0>>();
+	case 0x4: return run.template Go<PipelineConfig<false, true, false, 0x0>>();
+	case 0x5: return run.template Go<PipelineConfig<false, true, false, 0x1>>();
+	case 0x6: return run.template Go<PipelineConfig<false, true, true, 0x0>>();
+	case 0x8: return run.template Go<PipelineConfig<true, false, false, 0x0>>();
+	case 0x9: return run.template Go<PipelineConfig<true, false, false, 0x1>>();
+	case 0xA: return run.template Go<PipelineConfig<true, false, true, 0x0>>();
+	case 0xC: return run.template Go<PipelineConfig<true, true, false, 0x0>>();
+	case 0xD: return run.template Go<PipelineConfig<true, true, false, 0x1>>();
+	default: return run.template Go<PipelineConfig<true, true, true, 0x0>>();
+	}
+}
+
+// WarnUnsupported - flag a run that ran encodings the simulator does not implement as no-ops
+void WarnUnsupported(const std::string & workload, uint64_t unsupported)
+{
+	if (unsupported == 0x0) { return; }
+
+	std::cerr << "Warning: " << workload << ": " << unsupported << " instructions the simulator does not implement ran as no-ops" << std::endl;
+}
+
+// PrintSummary - the verbose run summary on stdout
+template <class Config>
+void PrintSummary(const Processor<Config> & processor, const SparseMemory & mainMemory, uint64_t cycles)
+{
+	const PredecodeCache & predecode{ processor.GetPredecodeCache() };
+	const PerformanceCounters & counters{ processor.GetCounters() };
+	std::cout << "cycles: " << cycles << ", retired: " << counters.GetRetired() << ", CPI: " << counters.GetCpi() << std::endl;
+	std::cout << "bubbles: " << counters.bubbles << ", forwards: " << counters.forwards << std::endl;
+	std::cout << "branches: " << counters.conditionalBranches << ", mispredicted: " << counters.mispredictions << " (";
+	std::cout << 100.0 * counters.GetBranchAccuracy() << "% accurate), flushed: " << counters.flushes << std::endl;
+	if (counters.fastForwarded != 0x0) { std::cout << "fast forwarded: " << counters.fastForwarded << " instructions" << std::endl; }
+	std::cout << "memory pages: " << mainMemory.GetPages() << " (" << mainMemory.GetPages() * PAGE_SIZE / 0x400 << " KiB)" << std::endl;
+	std::cout << "predecode lookups: " << predecode.GetLookups() << ", hits: " << predecode.GetHits();
+	std::cout << " (" << 100.0 * predecode.GetHitRate() << "%)" << std::endl;
+}
+
+//******************************************************************
+// File run - simulate the opened input into the opened output on *
+// a machine of the variant Dispatch picked, keeping its cycles   *
+// and counters, and printing the summary when asked to           *
+//******************************************************************
+struct FileRun
+{
+	const SimulationOptions & options;
+	std::ifstream & inputFile;
+	std::ofstream & outputFile;
+	SparseMemory & mainMemory;
+	JobResult & result;
+	bool summary;
+
+	template <class Config>
+	bool Go()
+	{
+		std::unique_ptr<Processor<Config>> processor(new Processor<Config>);
+		bool ok{ SimulateFiles(options, inputFile, outputFile, *processor, mainMemory, result.cycles) };
+
+		result.counters = processor->GetCounters();
+		if (ok && summary) { PrintSummary(*processor, mainMemory, result.cycles); }
+		WarnUnsupported(options.inputPath, result.counters.unsupported);
+
+		return ok;
+	}
+};
+
+//****************************************************************
+// RunJob - simulate one batch job on a machine of its own, safe *
+// to call from any pool worker                                  *
+//****************************************************************
+void RunJob(const BatchJob & job, JobResult & result)
+{
+	std::unique_ptr<SparseMemory> mainMemory(new SparseMemory);
 	std::ifstream inputFile;
 	std::ofstream outputFile;
+	const SimulationOptions & options{ job.options };
+	FileRun run{ options, inputFile, outputFile, *mainMemory, result, false };
 
-	InitializeMainMemory(mainMemory, 0x400);
-	uint32_t count{ LoadInputFile(inputFile) };
-	LoadOutputFile(outputFile);
+	std::chrono::steady_clock::time_point start{ std::chrono::steady_clock::now() };
+	result.ok = OpenInputFile(inputFile, options.inputPath) &&
+		OpenOutputFile(outputFile, options.outputPath, options.outputFormat == OutputFormat::Binary ? std::ios::binary : std::ios::out) &&
+		Dispatch(options, run);
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if (!result.ok) { std::cerr << "Error: batch job failed: " << job.label << std::endl; }
+}
 
-	inputInstructions = new uint32_t[count];
+//*******************************************************************
+// RunBatch - run every job of the manifest on the work stealing   *
+// pool and write one summary per job, in manifest order, to the   *
+// report; returns false if the manifest is invalid or a job fails *
+//*******************************************************************
+bool RunBatch(const SimulationOptions & options)
+{
+	std::vector<BatchJob> jobs;
+	std::ofstream reportFile;
+	bool ok{ true }, header{ true };
+
+	if (!LoadManifest(options.batchPath, jobs)) { return false; }
+	if (!options.reportPath.empty() && !OpenOutputFile(reportFile, options.reportPath, std::ios::out)) { return false; }
+
+	std::vector<JobResult> results(jobs.size());
+	WorkStealingPool pool(options.threads != 0x0 ? options.threads : std::thread::hardware_concurrency());
+
+	std::chrono::steady_clock::time_point start{ std::chrono::steady_clock::now() };
+	pool.Run(jobs.size(), [&jobs, &results](size_t job) { RunJob(jobs[job], results[job]); });
+	std::chrono::duration<double> elapsed{ std::chrono::steady_clock::now() - start };
+
+	std::ostream & report{ reportFile.is_open() ? static_cast<std::ostream &>(reportFile) : std::cout };
+	for (size_t i{ 0x0 }; i < jobs.size(); ++i)
+	{
+		ok = ok && results[i].ok;
+		if (!results[i].ok) { continue; }
+
+		WriteCounters(report, options.statsFormat, jobs[i].label, results[i].counters, header);
+		header = false;
+	}
 
-	std::string input{ "" };
-	for (size_t i{ 0 }; i < count; ++i)
+	if (options.verbose)
 	{
-		getline(inputFile, input);
-		inputInstructions[i] = strtoul(input.c_str(), NULL, 16);
+		std::cerr << "jobs: " << jobs.size() << ", workers: " << pool.GetWorkers() << ", steals: " << pool.GetSteals();
+		std::cerr << ", seconds: " << elapsed.count() << std::endl;
 	}
 
-	inputFile.close();
+	return ok;
+}
 
-	for (size_t i{ 0 }; i < count; ++i)
+// RunLaneTrace - execute the trace from its start on all lanes at once, for up to limit instructions (0 for no limit)
+template <class Trace>
+void RunLaneTrace(LaneEngine & engine, Trace & trace, const uint64_t limit)
+{
+	uint32_t instruction{ 0x0 };
+
+	while ((limit == 0x0 || engine.GetExecuted() < limit) && trace.Seek(engine.GetPc() >> 2) && trace.Next(instruction))
 	{
-		processor.InstructionFetchStage(inputInstructions[i]);
+		engine.Execute(instruction);
+	}
+}
+
+//******************************************************************
+// RunLanes - run the trace functionally over every lane state of  *
+// the lanes file in one pass, and write each lane's final         *
+// registers as one CSV row of the output, marking the lanes that  *
+// dropped out on a branch going another way than lane 0's         *
+//******************************************************************
+bool RunLanes(const SimulationOptions & options)
+{
+	std::vector<LaneState> states;
+	std::ifstream inputFile;
+	std::ofstream outputFile;
+
+	if (!LoadLaneStates(options.lanesPath, states)) { return false; }
+	if (!OpenInputFile(inputFile, options.inputPath) || !OpenOutputFile(outputFile, options.outputPath, std::ios::out)) { return false; }
+
+	LaneEngine engine(static_cast<uint32_t>(states.size()));
+	bool isElf{ IsElfFile(inputFile) };
+	bool isImage{ !isElf && IsImageFile(inputFile) };
+	ElfImage elf;
+	BinaryImage image;
+
+	if (isElf)
+	{
+		inputFile.close();
+		if (!elf.Open(options.inputPath)) { return false; }
+		engine.SetPc(elf.GetEntry());
+	}
+	else if (isImage)
+	{
+		inputFile.close();
+		if (!image.Open(options.inputPath)) { return false; }
+	}
+
+	// every lane starts from the default machine, or the executable's, then applies its own changes on top
+	for (uint32_t lane{ 0x0 }; lane < engine.GetLanes(); ++lane)
+	{
+		if (isElf)
+		{
+			if (!elf.SeedMemory(engine.GetMemory(lane))) { return false; }
+			engine.SetRegister(lane, STACK_REG, static_cast<int32_t>(ELF_STACK_TOP));
+		}
+		else
+		{
+			InitializeMainMemory(engine.GetMemory(lane), 0x400); // an executable brings its own data
+		}
+		if (isImage && !image.SeedMemory(engine.GetMemory(lane))) { return false; }
+
+		for (const LaneAssignment & assignment : states[lane])
+		{
+			if (assignment.memory) { engine.GetMemory(lane).StoreByte(assignment.target, static_cast<uint8_t>(assignment.val)); }
+			else { engine.SetRegister(lane, assignment.target, assignment.val); }
+		}
+	}
+
+	std::chrono::steady_clock::time_point start{ std::chrono::steady_clock::now() };
+	if (isElf)
+	{
+		ElfTraceReader trace(elf);
+		RunLaneTrace(engine, trace, options.cycleLimit);
+	}
+	else if (isImage)
+	{
+		ImageTraceReader trace(image);
+		RunLaneTrace(engine, trace, options.cycleLimit);
+	}
+	else
+	{
+		TraceReader trace(inputFile);
+		RunLaneTrace(engine, trace, options.cycleLimit);
+		inputFile.close();
+	}
+	std::chrono::duration<double> elapsed{ std::chrono::steady_clock::now() - start };
+
+	WarnUnsupported(options.inputPath, engine.GetUnsupported());
+
+	outputFile << "lane,diverged";
+	for (uint32_t reg{ 0x0 }; reg < 0x20; ++reg) { outputFile << ",$" << reg; }
+	outputFile << std::endl << std::hex;
+
+	for (uint32_t lane{ 0x0 }; lane < engine.GetLanes(); ++lane)
+	{
+		outputFile << std::dec << lane << ',' << (engine.IsActive(lane) ? 0x0 : 0x1) << std::hex;
+		for (uint32_t reg{ 0x0 }; reg < 0x20; ++reg) { outputFile << ",0x" << static_cast<uint32_t>(engine.GetRegister(lane, reg)); }
+		outputFile << std::endl;
+	}
+
+	CleanUp(outputFile);
+
+	if (options.verbose)
+	{
+		std::cout << "lanes: " << engine.GetLanes() << ", instructions: " << engine.GetExecuted() << ", seconds: " << elapsed.count();
+		std::cout << std::endl;
+	}
+
+	return true;
+}
+
+//***************************************************************
+// StrippedLoop - the bare single-issue cycle loop a variant is  *
+// timed against: the stages back to back on the words the trace *
+// hands out, with no fetch buffer, seeking, output, events or   *
+// checker; what decode held is fetched again, and the run       *
+// drains once the trace ends, or stops at the cycle limit, as   *
+// Simulate's does                                               *
+//***************************************************************
+template <class Config>
+uint64_t StrippedLoop(Processor<Config> & processor, SyntheticTrace & trace, SparseMemory & mainMemory, const uint64_t cycleLimit)
+{
+	uint32_t instruction{ 0x0 };
+	uint64_t cycle{ 0x0 };
+
+	for (bool fetched{ trace.Next(instruction) }; (fetched || !processor.IsDrained()) && (cycleLimit == 0 || cycle < cycleLimit); ++cycle)
+	{
+		if (processor.IsWaitingOnMemory())
+		{
+			processor.MemoryWaitCycle();
+			continue;
+		}
+
+		uint32_t fetchPc{ processor.GetPc() };
+
+		processor.Copy();
+		processor.InstructionFetchStage(&instruction, fetched ? 0x1 : 0x0);
 		processor.InstructionDecodeStage();
 		processor.ExecuteStage();
 		processor.MemoryStage(mainMemory);
 		processor.WriteBackStage();
-		processor.Print(outputFile);
-		processor.Copy();
+		if (fetched && processor.GetPc() != fetchPc) { fetched = trace.Next(instruction); } // straight-line code, so pc only moves on
+	}
+
+	return cycle;
+}
+
+// TimeStripped - run the stripped loop once on a fresh machine of the variant, keeping the fastest round's seconds
+template <class Config>
+void TimeStripped(const SimulationOptions & options, uint32_t round, uint64_t & cycles, double & seconds)
+{
+	std::unique_ptr<Processor<Config>> processor(new Processor<Config>);
+	SparseMemory mainMemory;
+	SyntheticTrace trace(options.workload);
+
+	ConfigureProcessor(*processor, options); // the variant's run has already checked the options
+	InitializeMainMemory(mainMemory, 0x400);
+
+	std::chrono::steady_clock::time_point start{ std::chrono::steady_clock::now() };
+	cycles = StrippedLoop(*processor, trace, mainMemory, options.cycleLimit);
+	double elapsed{ std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() };
+
+	if (round == 0x0 || elapsed < seconds) { seconds = elapsed; }
+}
+
+//****************************************************************
+// Benchmark run - time the synthetic workload through the        *
+// pipeline variant Dispatch picked, with output disabled, and    *
+// report the variant and the simulated cycle rate; an unobserved *
+// variant runs a few rounds, on a fresh machine each, and the    *
+// fastest counts; a single-issue one is compared with the        *
+// stripped loop, timed before or after it in turn, so neither    *
+// gains from going second                                        *
+//****************************************************************
+struct BenchmarkRun
+{
+	const SimulationOptions & options; // output already disabled
+
+	template <class Config>
+	bool Go();
+};
+
+template <class Config>
+bool BenchmarkRun::Go()
+{
+	const uint32_t rounds{ Config::OBSERVED ? 0x1 : BENCHMARK_ROUNDS }; // an observed run's events and checker are written once
+	const bool compared{ !Config::OBSERVED && Config::WIDTH == 0x1 };
+	std::unique_ptr<Processor<Config>> processor;
+	OutputSink sink(std::cout, options);
+	SyntheticTrace checkTrace(options.workload); // the same seed generates the same stream again
+	std::unique_ptr<EventRecorder> events(options.eventsPath.empty() ? nullptr : new EventRecorder(options.eventCapacity));
+	std::unique_ptr<Checker<Config, SyntheticTrace>> checker(options.check ? new Checker<Config, SyntheticTrace>(checkTrace) : nullptr);
+	uint64_t cycles{ 0x0 }, strippedCycles{ 0x0 };
+	double seconds{ 0.0 }, strippedSeconds{ 0.0 };
+
+	for (uint32_t round{ 0x0 }; round < rounds; ++round)
+	{
+		if (compared && round % 0x2 == 0x1) { TimeStripped<Config>(options, round, strippedCycles, strippedSeconds); }
+
+		SparseMemory mainMemory;
+		SyntheticTrace trace(options.workload);
+
+		processor.reset(new Processor<Config>);
+		if (!ConfigureProcessor(*processor, options)) { return false; }
+		InitializeMainMemory(mainMemory, 0x400);
+		if (checker) { checker->Start(*processor, mainMemory); }
+
+		std::chrono::steady_clock::time_point start{ std::chrono::steady_clock::now() };
+		uint64_t tracePosition{ 0x0 };
+		cycles = Simulate(*processor, trace, mainMemory, sink, 0x0, options.cycleLimit, tracePosition, events.get(), checker.get());
+		double elapsed{ std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() };
+
+		if (round == 0x0 || elapsed < seconds) { seconds = elapsed; }
+		if (compared && round % 0x2 == 0x0) { TimeStripped<Config>(options, round, strippedCycles, strippedSeconds); }
+	}
+
+	std::cout << "pipeline variant: " << Config::Describe() << std::endl;
+	ReportBenchmark(std::cout, options.workload, rounds, cycles, seconds);
+	if (compared) { ReportStrippedLoop(std::cout, strippedCycles, strippedSeconds, seconds); }
+
+	return WriteStats(options, "synthetic", processor->GetCounters()) && WriteEvents(options, events.get()) &&
+		FinishCheck(options, checker.get(), *processor, cycles);
+}
+
+// RunBenchmark - the benchmark on the variant for the options, which never dump
+bool RunBenchmark(const SimulationOptions & options)
+{
+	SimulationOptions silent{ options };
+	BenchmarkRun run{ silent };
+
+	silent.outputLevel = OutputLevel::None;
+
+	return Dispatch(silent, run);
+}
+
+int main(int argc, char * argv[])
+{
+	SimulationOptions options;
+	SparseMemory mainMemory;
+	std::ifstream inputFile;
+	std::ofstream outputFile;
+	JobResult result;
+
+	if (!ParseCommandLine(argc, argv, options))
+	{
+		PrintUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (options.convert) { return ConvertTextTrace(options) ? EXIT_SUCCESS : EXIT_FAILURE; }
+	if (options.prettyPrint) { return PrettyPrintSnapshots(options.inputPath, options.outputPath) ? EXIT_SUCCESS : EXIT_FAILURE; }
+	if (options.benchmark)
+	{
+		return RunBenchmark(options) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	if (options.batch) { return RunBatch(options) ? EXIT_SUCCESS : EXIT_FAILURE; }
+	if (!options.lanesPath.empty()) { return RunLanes(options) ? EXIT_SUCCESS : EXIT_FAILURE; }
+
+	if (options.interactive)
+	{
+		options.inputPath = LoadInputFile(inputFile);
+		LoadOutputFile(outputFile);
+	}
+	else if (!OpenInputFile(inputFile, options.inputPath) ||
+		!OpenOutputFile(outputFile, options.outputPath, options.outputFormat == OutputFormat::Binary ? std::ios::binary : std::ios::out))
+	{
+		return EXIT_FAILURE;
 	}
 
-	CleanUp(outputFile, inputInstructions);
+	FileRun run{ options, inputFile, outputFile, mainMemory, result, options.verbose };
 
-	return EXIT_SUCCESS;
-}
\ No newline at end of file
+	return Dispatch(options, run) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
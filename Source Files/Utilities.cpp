@@ -1,26 +1,33 @@
+#include <cctype>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
-#include <iterator>
+#include <sstream>
 #include <string>
+#include <vector>
+#include "ImageFormat.h"
+#include "Options.h"
+#include "SparseMemory.h"
 
-void InitializeMainMemory(int32_t * mainMemory, const uint32_t count)
+void InitializeMainMemory(SparseMemory & mainMemory, const uint32_t count)
 {
 	uint32_t initializer{ 0x0 };
 
-	for (size_t i{ 0x0 }; i < 0x400; ++i)
+	for (uint32_t i{ 0x0 }; i < count; ++i)
 	{
 		if (initializer == 0x100)
 		{
 			initializer = 0x0;
 		}
 
-		mainMemory[i] = initializer;
+		mainMemory.StoreByte(i, static_cast<uint8_t>(initializer));
 		++initializer;
 	}
 }
 
-size_t LoadInputFile(std::ifstream & inputFile)
+std::string LoadInputFile(std::ifstream & inputFile)
 {
 	std::string filename{ "" };
 	std::cout << "Enter the input file path and filename: ";
@@ -35,15 +42,7 @@ size_t LoadInputFile(std::ifstream & inputFile)
 		inputFile.open(filename);
 	}
 
-	// get the size of the array of instructions to be created
-	inputFile.unsetf(std::ios_base::skipws);
-	size_t count = (std::count(std::istream_iterator<char>(inputFile), std::istream_iterator<char>(), '\n') + 1);
-
-	// return to the top of the input file for reading
-	inputFile.clear();
-	inputFile.seekg(0, std::ios::beg);
-
-	return count;
+	return filename;
 }
 
 void LoadOutputFile(std::ofstream & outputFile)
@@ -62,9 +61,541 @@ void LoadOutputFile(std::ofstream & outputFile)
 	}
 }
 
-void CleanUp(std::ofstream & outputFile, uint32_t * inputInstructions)
+bool OpenInputFile(std::ifstream & inputFile, const std::string & filename)
+{
+	inputFile.open(filename);
+	if (inputFile.fail())
+	{
+		std::cerr << "Error: invalid input file: " << filename << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool OpenOutputFile(std::ofstream & outputFile, const std::string & filename, std::ios::openmode mode)
+{
+	outputFile.open(filename, mode | std::ios::out);
+	if (outputFile.fail())
+	{
+		std::cerr << "Error: invalid output file: " << filename << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+//**************************************************************
+// ParseUintList - read up to count comma separated values,    *
+// returns how many were read, or 0 if the list is malformed   *
+//**************************************************************
+static size_t ParseUintList(const char * text, uint32_t * values, size_t count)
+{
+	char * end{ nullptr };
+
+	for (size_t i{ 0x0 }; i < count; ++i)
+	{
+		values[i] = static_cast<uint32_t>(strtoul(text, &end, 0));
+
+		if (end == text) { return 0x0; }
+		if (*end == '\0') { return i + 1; }
+		if (*end != ',') { return 0x0; }
+		text = end + 1;
+	}
+
+	return 0x0; // more values than asked for
+}
+
+//*************************************************************
+// ParseWorkloadMix - read "add,sub,lb,sb,nop" weights, e.g.  *
+// "40,20,20,10,10", returns false if the list is malformed   *
+//*************************************************************
+static bool ParseWorkloadMix(const char * text, WorkloadMix & mix)
+{
+	uint32_t total{ 0x0 };
+	char * end{ nullptr };
+
+	for (size_t i{ 0x0 }; i < WORK_CLASSES; ++i)
+	{
+		mix.weights[i] = static_cast<uint32_t>(strtoul(text, &end, 0));
+		total += mix.weights[i];
+
+		if (end == text || *end != (i + 1 == WORK_CLASSES ? '\0' : ',')) { return false; }
+		text = end + 1;
+	}
+
+	return total != 0x0;
+}
+
+void PrintUsage(const char * program)
+{
+	std::cerr << "Usage: " << program << " [-i <input trace>] [-o <output file>] [-n <cycle limit>] [-v] [--no-forwarding]" << std::endl;
+	std::cerr << "       " << program << " --convert -i <text trace> -o <image> [-d <data words>] [--data-base <address>]" << std::endl;
+	std::cerr << "       " << program << " --pretty-print -i <binary snapshots> -o <text file>" << std::endl;
+	std::cerr << "       " << program << " --batch <manifest> [--threads <n>] [--report <file>] [--stats-format json|csv] [-v]" << std::endl;
+	std::cerr << "       " << program << " --lanes <lane states> -i <input trace> -o <results file> [-n <instruction limit>]" << std::endl;
+	std::cerr << "       " << program << " --benchmark <instructions> [--mix add,sub,lb,sb,nop] [--dep-distance <n>] [--seed <n>]" << std::endl;
+	std::cerr << "Options: --output-level none|final|cycle|<every N cycles>  --output-format text|binary" << std::endl;
+	std::cerr << "         --stats <file> [--stats-format json|csv] writes the performance counters when the run ends" << std::endl;
+	std::cerr << "         --trace-events <file> [--trace-events-size <events>] writes what each stage held, cycle by cycle," << std::endl;
+	std::cerr << "         as Chrome trace events for a trace viewer; only the most recent events are kept" << std::endl;
+	std::cerr << "         --save-checkpoint <file> saves the machine when the run stops (e.g. after -n cycles)," << std::endl;
+	std::cerr << "         --restore <file> resumes from it; -n then counts the cycles of this run only" << std::endl;
+	std::cerr << "         --fast-forward <instructions> executes that many functionally before the pipeline takes over," << std::endl;
+	std::cerr << "         --functional executes the whole trace functionally" << std::endl;
+	std::cerr << "         --issue-width 1|2|4 moves bundles of that many instructions through each stage a cycle;" << std::endl;
+	std::cerr << "         a restored checkpoint goes on at the width it was saved at" << std::endl;
+	std::cerr << "         --check runs a reference model in lockstep, comparing each retired register write and store," << std::endl;
+	std::cerr << "         and stops at the first difference; not with --restore" << std::endl;
+	std::cerr << "         --compare-functional also runs the trace functionally and fails unless both runs end with the same" << std::endl;
+	std::cerr << "         registers and memory; not with --restore or -n" << std::endl;
+	std::cerr << "         --dcache <bytes>[,<line bytes>[,<ways>]] --dcache-latency <hit>,<miss penalty>" << std::endl;
+	std::cerr << "         --dcache-replace lru|random  --dcache-write back|through adds a data cache in front of memory" << std::endl;
+	std::cerr << "         --predictor not-taken|bimodal|gshare [--predictor-size <counters>[,<BTB entries>]] predicts branches at fetch" << std::endl;
+	std::cerr << "Runs interactively, prompting for the files, when no arguments are given." << std::endl;
+	std::cerr << "The input may be a hex text trace or a binary image made with --convert." << std::endl;
+	std::cerr << "Its words are the program, word i at address 4 * i, run from address 0 until fetch passes its end" << std::endl;
+	std::cerr << "and every instruction still in the pipeline has retired, so a trace needs no trailing nops." << std::endl;
+	std::cerr << "It may also be a statically linked ELF32 MIPS executable, big or little-endian, run from its entry point" << std::endl;
+	std::cerr << "with its segments in main memory and $sp at the top of user space until fetch leaves its code and the pipeline drains." << std::endl;
+	std::cerr << "Branches and jumps have no delay slot, so an executable is refused unless each is followed by a nop." << std::endl;
+	std::cerr << "Instructions the simulator does not implement run as no-ops, with a warning; --check stops at the first." << std::endl;
+	std::cerr << "--benchmark reports the fastest of a few rounds, and times a single-issue run against a stripped cycle loop." << std::endl;
+}
+
+bool ParseCommandLine(int argc, char * argv[], SimulationOptions & options)
+{
+	for (int i{ 1 }; i < argc; ++i)
+	{
+		// options without a value
+		if (!strcmp(argv[i], "--convert"))
+		{
+			options.convert = true;
+			continue;
+		}
+		else if (!strcmp(argv[i], "--pretty-print"))
+		{
+			options.prettyPrint = true;
+			continue;
+		}
+		else if (!strcmp(argv[i], "-v") || !strcmp(argv[i], "--verbose"))
+		{
+			options.verbose = true;
+			continue;
+		}
+		else if (!strcmp(argv[i], "--no-forwarding"))
+		{
+			options.forwarding = false;
+			continue;
+		}
+		else if (!strcmp(argv[i], "--functional"))
+		{
+			options.fastForward = UINT64_MAX; // the whole trace
+			continue;
+		}
+		else if (!strcmp(argv[i], "--check"))
+		{
+			options.check = true;
+			continue;
+		}
+		else if (!strcmp(argv[i], "--compare-functional"))
+		{
+			options.compareFunctional = true;
+			continue;
+		}
+
+		if (i + 1 >= argc) { return false; } // everything else takes a value
+
+		if (!strcmp(argv[i], "-i") || !strcmp(argv[i], "--input"))
+		{
+			options.inputPath = argv[++i];
+		}
+		else if (!strcmp(argv[i], "-o") || !strcmp(argv[i], "--output"))
+		{
+			options.outputPath = argv[++i];
+		}
+		else if (!strcmp(argv[i], "-n") || !strcmp(argv[i], "--cycles"))
+		{
+			options.cycleLimit = strtoull(argv[++i], NULL, 0);
+		}
+		else if (!strcmp(argv[i], "-d") || !strcmp(argv[i], "--data"))
+		{
+			options.dataPath = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--data-base"))
+		{
+			options.dataBase = static_cast<uint32_t>(strtoul(argv[++i], NULL, 0));
+		}
+		else if (!strcmp(argv[i], "--batch"))
+		{
+			options.batch = true;
+			options.batchPath = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--threads"))
+		{
+			options.threads = static_cast<uint32_t>(strtoul(argv[++i], NULL, 0));
+		}
+		else if (!strcmp(argv[i], "--report"))
+		{
+			options.reportPath = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--lanes"))
+		{
+			options.lanesPath = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--benchmark"))
+		{
+			options.benchmark = true;
+			options.workload.instructions = strtoull(argv[++i], NULL, 0);
+		}
+		else if (!strcmp(argv[i], "--mix"))
+		{
+			if (!ParseWorkloadMix(argv[++i], options.workload)) { return false; }
+		}
+		else if (!strcmp(argv[i], "--dep-distance"))
+		{
+			options.workload.dependencyDistance = static_cast<uint32_t>(strtoul(argv[++i], NULL, 0));
+			if (options.workload.dependencyDistance > MAX_DEPENDENCY_DISTANCE) { return false; }
+		}
+		else if (!strcmp(argv[i], "--seed"))
+		{
+			options.workload.seed = strtoull(argv[++i], NULL, 0);
+		}
+		else if (!strcmp(argv[i], "--output-level"))
+		{
+			const char * level{ argv[++i] };
+
+			if (!strcmp(level, "none")) { options.outputLevel = OutputLevel::None; }
+			else if (!strcmp(level, "final")) { options.outputLevel = OutputLevel::Final; }
+			else if (!strcmp(level, "cycle")) { options.outputLevel = OutputLevel::Cycle; }
+			else if ((options.outputInterval = strtoull(level, NULL, 0)) != 0x0) { options.outputLevel = OutputLevel::Interval; }
+			else { return false; }
+		}
+		else if (!strcmp(argv[i], "--dcache"))
+		{
+			uint32_t geometry[3]{ 0x0, options.dcache.lineSize, options.dcache.ways };
+			if (ParseUintList(argv[++i], geometry, 3) == 0x0) { return false; }
+
+			options.dcache.size = geometry[0];
+			options.dcache.lineSize = geometry[1];
+			options.dcache.ways = geometry[2];
+		}
+		else if (!strcmp(argv[i], "--dcache-latency"))
+		{
+			uint32_t latency[2]{ options.dcache.hitLatency, options.dcache.missPenalty };
+			if (ParseUintList(argv[++i], latency, 2) != 2) { return false; }
+
+			options.dcache.hitLatency = latency[0];
+			options.dcache.missPenalty = latency[1];
+		}
+		else if (!strcmp(argv[i], "--dcache-replace"))
+		{
+			const char * policy{ argv[++i] };
+
+			if (!strcmp(policy, "lru")) { options.dcache.replacement = CacheReplacement::Lru; }
+			else if (!strcmp(policy, "random")) { options.dcache.replacement = CacheReplacement::Random; }
+			else { return false; }
+		}
+		else if (!strcmp(argv[i], "--dcache-write"))
+		{
+			const char * policy{ argv[++i] };
+
+			if (!strcmp(policy, "back")) { options.dcache.writePolicy = CacheWritePolicy::WriteBack; }
+			else if (!strcmp(policy, "through")) { options.dcache.writePolicy = CacheWritePolicy::WriteThrough; }
+			else { return false; }
+		}
+		else if (!strcmp(argv[i], "--issue-width"))
+		{
+			options.issueWidth = static_cast<uint32_t>(strtoul(argv[++i], NULL, 0));
+		}
+		else if (!strcmp(argv[i], "--trace-events"))
+		{
+			options.eventsPath = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--trace-events-size"))
+		{
+			options.eventCapacity = static_cast<uint32_t>(strtoul(argv[++i], NULL, 0));
+			if (options.eventCapacity == 0x0) { return false; }
+		}
+		else if (!strcmp(argv[i], "--predictor"))
+		{
+			const char * kind{ argv[++i] };
+
+			if (!strcmp(kind, "not-taken")) { options.predictor.kind = PredictorKind::NotTaken; }
+			else if (!strcmp(kind, "bimodal")) { options.predictor.kind = PredictorKind::Bimodal; }
+			else if (!strcmp(kind, "gshare")) { options.predictor.kind = PredictorKind::Gshare; }
+			else { return false; }
+		}
+		else if (!strcmp(argv[i], "--predictor-size"))
+		{
+			uint32_t sizes[2]{ options.predictor.counters, options.predictor.btbEntries };
+			if (ParseUintList(argv[++i], sizes, 2) == 0x0) { return false; }
+
+			options.predictor.counters = sizes[0];
+			options.predictor.btbEntries = sizes[1];
+		}
+		else if (!strcmp(argv[i], "--restore"))
+		{
+			options.restorePath = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--fast-forward"))
+		{
+			options.fastForward = strtoull(argv[++i], NULL, 0);
+		}
+		else if (!strcmp(argv[i], "--save-checkpoint"))
+		{
+			options.savePath = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--stats"))
+		{
+			options.statsPath = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--stats-format"))
+		{
+			const char * format{ argv[++i] };
+
+			if (!strcmp(format, "json")) { options.statsFormat = StatsFormat::Json; }
+			else if (!strcmp(format, "csv")) { options.statsFormat = StatsFormat::Csv; }
+			else { return false; }
+		}
+		else if (!strcmp(argv[i], "--output-format"))
+		{
+			const char * format{ argv[++i] };
+
+			if (!strcmp(format, "text")) { options.outputFormat = OutputFormat::Text; }
+			else if (!strcmp(format, "binary")) { options.outputFormat = OutputFormat::Binary; }
+			else { return false; }
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	// a restored pipeline may hold instructions in flight, which functional execution would skip past
+	if (options.fastForward != 0x0 && !options.restorePath.empty()) { return false; }
+
+	// the reference model starts from the registers and memory, which a restored pipeline's instructions in flight have yet to reach
+	if (options.check && !options.restorePath.empty()) { return false; }
+
+	// the functional run starts from an empty pipeline too, and only a run that drained has finished the trace to compare with it
+	if (options.compareFunctional && (!options.restorePath.empty() || options.cycleLimit != 0x0)) { return false; }
+
+	// lanes only ever run functionally, from the start of the trace
+	if (!options.lanesPath.empty() && (!options.restorePath.empty() || !options.savePath.empty() || options.batch || options.compareFunctional)) { return false; }
+
+	// batch mode needs both files, otherwise fall back to the prompts
+	if (options.benchmark || options.batch)
+	{
+		options.interactive = false;
+	}
+	else if (argc > 1)
+	{
+		if (options.inputPath.empty() || options.outputPath.empty()) { return false; }
+		options.interactive = false;
+	}
+
+	return true;
+}
+
+// copy one hex word per line from a text file into the image, returns the word count
+static uint32_t WriteImageWords(std::ifstream & textFile, std::ofstream & imageFile)
+{
+	uint32_t buffer[0x400], buffered{ 0x0 }, written{ 0x0 };
+	std::string line{ "" };
+
+	while (getline(textFile, line))
+	{
+		buffer[buffered++] = ImageWord(static_cast<uint32_t>(strtoul(line.c_str(), NULL, 16)));
+
+		if (buffered == 0x400)
+		{
+			imageFile.write(reinterpret_cast<const char *>(buffer), sizeof(buffer));
+			written += buffered;
+			buffered = 0x0;
+		}
+	}
+
+	imageFile.write(reinterpret_cast<const char *>(buffer), buffered * sizeof(uint32_t));
+
+	return written + buffered;
+}
+
+bool ConvertTextTrace(const SimulationOptions & options)
+{
+	std::ifstream textFile, dataFile;
+	std::ofstream imageFile;
+	ImageHeader header{};
+
+	if (!OpenInputFile(textFile, options.inputPath)) { return false; }
+	if (!options.dataPath.empty() && !OpenInputFile(dataFile, options.dataPath)) { return false; }
+
+	imageFile.open(options.outputPath, std::ios::binary);
+	if (imageFile.fail())
+	{
+		std::cerr << "Error: invalid output file: " << options.outputPath << std::endl;
+		return false;
+	}
+
+	// the header is written last, once the section sizes are known
+	imageFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+	memcpy(header.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+	header.version = ImageWord(IMAGE_VERSION);
+	header.textWords = ImageWord(WriteImageWords(textFile, imageFile));
+	header.dataWords = ImageWord(dataFile.is_open() ? WriteImageWords(dataFile, imageFile) : 0x0);
+	header.dataBase = ImageWord(options.dataBase);
+
+	imageFile.seekp(0, std::ios::beg);
+	imageFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	imageFile.close();
+
+	if (imageFile.fail())
+	{
+		std::cerr << "Error: failed writing image: " << options.outputPath << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+//******************************************************************
+// LoadManifest - read one batch job per line, each written as the *
+// options of a single run (-i and -o included), "quoted" where a  *
+// path has spaces; blank lines and # comments are skipped         *
+//******************************************************************
+bool LoadManifest(const std::string & filename, std::vector<BatchJob> & jobs)
+{
+	std::ifstream manifest;
+	std::string line{ "" };
+	uint32_t lineNumber{ 0x0 };
+
+	if (!OpenInputFile(manifest, filename)) { return false; }
+
+	while (getline(manifest, line))
+	{
+		std::vector<std::string> tokens{ "job" }; // stands in for the program name
+		std::vector<char *> args;
+		size_t i{ 0x0 };
+
+		++lineNumber;
+		if (!line.empty() && line.back() == '\r') { line.pop_back(); }
+
+		while (i < line.size())
+		{
+			if (isspace(static_cast<unsigned char>(line[i]))) { ++i; continue; }
+			if (line[i] == '#') { break; }
+
+			size_t end{ line[i] == '"' ? line.find('"', i + 1) : line.find_first_of(" \t", i) };
+			if (line[i] == '"')
+			{
+				if (end == std::string::npos) { end = line.size(); }
+				tokens.push_back(line.substr(i + 1, end - i - 1));
+				i = end + 1;
+			}
+			else
+			{
+				if (end == std::string::npos) { end = line.size(); }
+				tokens.push_back(line.substr(i, end - i));
+				i = end;
+			}
+		}
+
+		if (tokens.size() == 0x1) { continue; }
+
+		for (std::string & token : tokens) { args.push_back(&token[0]); }
+
+		BatchJob job;
+		if (!ParseCommandLine(static_cast<int>(args.size()), args.data(), job.options) || job.options.batch ||
+			job.options.benchmark || job.options.convert || job.options.prettyPrint)
+		{
+			std::cerr << "Error: invalid batch job on line " << lineNumber << " of " << filename << std::endl;
+			return false;
+		}
+		if (!job.options.lanesPath.empty()) // lanes write their own results file, outside the batch report
+		{
+			std::cerr << "Error: --lanes cannot run as a batch job, on line " << lineNumber << " of " << filename << std::endl;
+			return false;
+		}
+
+		job.label = line;
+		jobs.push_back(job);
+	}
+
+	return true;
+}
+
+void CleanUp(std::ofstream & outputFile)
 {
 	outputFile.close();
-	delete [] inputInstructions;
-	inputInstructions = nullptr;
-}
\ No newline at end of file
+}
+
+//*******************************************************************
+// LoadLaneStates - read one lane per line, each a list of $<reg>=  *
+// <value> and [<address>]=<byte> changes to the default machine,   *
+// or just "default"; blank lines and # comments are skipped        *
+//*******************************************************************
+bool LoadLaneStates(const std::string & filename, std::vector<LaneState> & lanes)
+{
+	std::ifstream file;
+	std::string line{ "" };
+	uint32_t lineNumber{ 0x0 };
+
+	if (!OpenInputFile(file, filename)) { return false; }
+
+	while (getline(file, line))
+	{
+		std::istringstream tokens(line.substr(0x0, line.find('#')));
+		std::string token{ "" };
+		LaneState lane;
+		bool any{ false }, ok{ true };
+
+		++lineNumber;
+		while (ok && tokens >> token)
+		{
+			LaneAssignment assignment{ false, 0x0, 0x0 };
+			size_t equals{ token.find('=') };
+			char * end{ nullptr };
+
+			any = true;
+			if (token == "default") { continue; }
+			if (equals == std::string::npos || equals + 1 >= token.size()) { ok = false; break; }
+
+			if (token[0] == '$')
+			{
+				assignment.target = static_cast<uint32_t>(strtoul(token.c_str() + 1, &end, 0));
+				ok = end == token.c_str() + equals && equals > 1 && assignment.target < 0x20;
+			}
+			else if (token[0] == '[' && equals > 2 && token[equals - 1] == ']')
+			{
+				assignment.memory = true;
+				assignment.target = static_cast<uint32_t>(strtoul(token.c_str() + 1, &end, 0));
+				ok = end == token.c_str() + equals - 1;
+			}
+			else
+			{
+				ok = false;
+			}
+
+			assignment.val = static_cast<int32_t>(strtoll(token.c_str() + equals + 1, &end, 0));
+			ok = ok && *end == '\0';
+			lane.push_back(assignment);
+		}
+
+		if (!ok)
+		{
+			std::cerr << "Error: invalid lane state on line " << lineNumber << " of " << filename << std::endl;
+			return false;
+		}
+
+		if (any) { lanes.push_back(lane); }
+	}
+
+	if (lanes.empty())
+	{
+		std::cerr << "Error: no lanes in " << filename << std::endl;
+		return false;
+	}
+
+	return true;
+}
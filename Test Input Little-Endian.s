@@ -0,0 +1,87 @@
+# Test Input Little-Endian.s - sized loads and stores on a little-endian
+# executable; each load is checked against the value the little-endian byte
+# order gives, and any difference is ORed into $v0
+#
+# Built into Test Input Little-Endian.elf with the GNU binutils for mipsel:
+#   mipsel-linux-gnu-as -EL -mips1 -o le.o "Test Input Little-Endian.s"
+#   mipsel-linux-gnu-ld -EL -static -e __start -Ttext 0x400000 -Tdata 0x10010000 -o "Test Input Little-Endian.elf" le.o
+#
+# Expected final state (Test Input Little-Endian Expected.txt holds the registers):
+#   $v0 = 0, $t0 = 0x10010000, $t1 = $t2 = 0x01020304, $t3 = 0
+#   the 12 data bytes at 0x10010000: 11 22 33 84 99 66 bb aa 04 03 02 01
+
+	.set	noreorder
+	.set	noat
+
+	.data
+data:
+	.byte	0x11, 0x22, 0x33, 0x84, 0x55, 0x66, 0x77, 0x88
+	.word	0
+
+	.text
+	.globl	__start
+__start:
+	or	$v0, $zero, $zero
+	lui	$t0, 0x1001                    # $t0 = data
+	lw	$t1, 0($t0)                     # whole word
+	lui	$t2, 0x8433
+	ori	$t2, $t2, 0x2211               # expected 0x84332211
+	subu	$t3, $t1, $t2
+	or	$v0, $v0, $t3                   # any difference stays in $v0
+	lh	$t1, 0($t0)                     # low half
+	lui	$t2, 0x0000
+	ori	$t2, $t2, 0x2211               # expected 0x00002211
+	subu	$t3, $t1, $t2
+	or	$v0, $v0, $t3                   # any difference stays in $v0
+	lh	$t1, 2($t0)                     # high half, sign extended
+	lui	$t2, 0xffff
+	ori	$t2, $t2, 0x8433               # expected 0xffff8433
+	subu	$t3, $t1, $t2
+	or	$v0, $v0, $t3                   # any difference stays in $v0
+	lb	$t1, 0($t0)                     # lowest byte
+	lui	$t2, 0x0000
+	ori	$t2, $t2, 0x0011               # expected 0x00000011
+	subu	$t3, $t1, $t2
+	or	$v0, $v0, $t3                   # any difference stays in $v0
+	lb	$t1, 3($t0)                     # highest byte, sign extended
+	lui	$t2, 0xffff
+	ori	$t2, $t2, 0xff84               # expected 0xffffff84
+	subu	$t3, $t1, $t2
+	or	$v0, $v0, $t3                   # any difference stays in $v0
+	lw	$t1, 4($t0)                     # second word
+	lui	$t2, 0x8877
+	ori	$t2, $t2, 0x6655               # expected 0x88776655
+	subu	$t3, $t1, $t2
+	or	$v0, $v0, $t3                   # any difference stays in $v0
+	ori	$t2, $zero, 0x0099
+	sb	$t2, 4($t0)                     # byte 4 becomes 0x99
+	lw	$t1, 4($t0)
+	lui	$t2, 0x8877
+	ori	$t2, $t2, 0x6699               # expected 0x88776699
+	subu	$t3, $t1, $t2
+	or	$v0, $v0, $t3                   # any difference stays in $v0
+	ori	$t2, $zero, 0xaabb
+	sh	$t2, 6($t0)                     # bytes 6 and 7 become bb aa
+	lw	$t1, 4($t0)
+	lui	$t2, 0xaabb
+	ori	$t2, $t2, 0x6699               # expected 0xaabb6699
+	subu	$t3, $t1, $t2
+	or	$v0, $v0, $t3                   # any difference stays in $v0
+	lui	$t2, 0x0102
+	ori	$t2, $t2, 0x0304
+	sw	$t2, 8($t0)                     # bytes 8 to 11 become 04 03 02 01
+	lb	$t1, 8($t0)
+	lui	$t2, 0x0000
+	ori	$t2, $t2, 0x0004               # expected 0x00000004
+	subu	$t3, $t1, $t2
+	or	$v0, $v0, $t3                   # any difference stays in $v0
+	lh	$t1, 10($t0)
+	lui	$t2, 0x0000
+	ori	$t2, $t2, 0x0102               # expected 0x00000102
+	subu	$t3, $t1, $t2
+	or	$v0, $v0, $t3                   # any difference stays in $v0
+	lw	$t1, 8($t0)
+	lui	$t2, 0x0102
+	ori	$t2, $t2, 0x0304               # expected 0x01020304
+	subu	$t3, $t1, $t2
+	or	$v0, $v0, $t3                   # any difference stays in $v0